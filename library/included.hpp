@@ -2,9 +2,19 @@
 #define SYLVAIN__CODINGAME_INCLUDED
 
 #include <tuple>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
 #include <cmath>
 #include <array>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 // This is the canonical implementation for absolute. It's so beautiful, I
 // wanted to write it again. It just blows my mind everytime I look at it.
@@ -110,7 +120,7 @@ constexpr inline Tp sq(Tp x) { return x * x; }
 //   - start at the Manhattan magnitude (a.k.a taxicab metric)
 //   - we know values are necessarily positive, so add +1 to avoid div by 0
 //   - do 3 iterations of Newton's method
-inline int ihyp(const int adjacent, const int opposite)
+constexpr inline int ihyp(const int adjacent, const int opposite)
 {
   int S = sq(adjacent) + sq(opposite);
   int a = iabs(adjacent), o = iabs(opposite);
@@ -129,7 +139,7 @@ inline int ihyp(const int adjacent, const int opposite)
 // of sign and quadrant to use: sin(x) or sin(90 - x).
 //
 // It should have less than 2% of error.
-inline int isin(int angle, int scale) {
+constexpr inline int isin(int angle, int scale) {
   constexpr const int Factor = 81;               // 256 / PI ~= 81
   constexpr const int Factor2 = 54 * sq(Factor); // 9 * 3! * (256/PI ~= 81)^2
   constexpr const float Factor3 = Factor2 * Factor;
@@ -145,7 +155,7 @@ inline int isin(int angle, int scale) {
   return (ra^s) - s;
 }
 
-inline int icos(int angle, int scale) {
+constexpr inline int icos(int angle, int scale) {
   return isin(90 - angle, scale);
 }
 
@@ -172,7 +182,7 @@ inline int icos(int angle, int scale) {
 //
 // Note that if `hypot` is 0, the result is undefined. `hypot` is assumed to be
 // properly computed, and in particular, always greater than `x`.
-inline int iacos3(int x, int y, int hypot) {
+constexpr inline int iacos3(int x, int y, int hypot) {
   constexpr const float A = -53.807358428;
   constexpr const float B = 52.814341583;
   constexpr const float C = -1.284590624;
@@ -188,7 +198,7 @@ inline int iacos3(int x, int y, int hypot) {
 // Return an angle in degree for the value of the adjacent length `x`, the
 // opposite length`y` with less than 0.5% error.
 //
-inline int iacos2(int x, int y) {
+constexpr inline int iacos2(int x, int y) {
   return iacos3(x, y, ihyp(x, y));
 }
 
@@ -225,10 +235,10 @@ constexpr inline Vec2 operator* (const Vec2& a, float factor)
 constexpr inline Vec2 operator/ (const Vec2& a, float factor)
 { return {int(float(x(a)) / factor), int(float(y(a)) / factor)}; }
 
-inline Vec2 operator<< (const Vec2& a, int factor)
+constexpr inline Vec2 operator<< (const Vec2& a, int factor)
 { return {x(a) << factor, y(a) << factor}; }
 
-inline Vec2 operator>> (const Vec2& a, int factor)
+constexpr inline Vec2 operator>> (const Vec2& a, int factor)
 { return {x(a) >> factor, y(a) >> factor}; }
 
 constexpr inline bool operator== (const Vec2& a, const Vec2& b)
@@ -239,17 +249,17 @@ constexpr inline bool operator!= (const Vec2& a, const Vec2& b) { return !(a ==
 constexpr inline int magsq(const Vec2& a)
 { return sq(x(a)) + sq(y(a)); }
 
-inline int distsq(const Vec2& a, const Vec2& b)
+constexpr inline int distsq(const Vec2& a, const Vec2& b)
 { return magsq(a - b); }
 
-inline int mag(const Vec2& a) { return ihyp(x(a), y(a)); }
+constexpr inline int mag(const Vec2& a) { return ihyp(x(a), y(a)); }
 
 // Similar to mag, normalize cares to:
 //
 //   - avoid overflows/underflows by computing divisions last
 //   - avoid divisions by 0 with +1 since all values in the diviser are
 //     guaranteed positives
-inline Vec2 norm(const Vec2& a, int norm)
+constexpr inline Vec2 norm(const Vec2& a, int norm)
 {
   int m = mag(a);
   return {(x(a) * norm) / (m + 1), (y(a) * norm) / (m + 1)};
@@ -270,7 +280,7 @@ constexpr inline bool within(const Box2& b, const Vec2& v) {
 // Given two positions at discreet time t0 and t1 and a distance of closest
 // appraoch `sqrad`, perform recursive halving of the time interval to check
 // whether the particle collided.
-inline int linear_collide(Vec2 x0, Vec2 y0, Vec2 x1, Vec2 y1, int sqrad) {
+constexpr inline int linear_collide(Vec2 x0, Vec2 y0, Vec2 x1, Vec2 y1, int sqrad) {
   constexpr const int stop_delta = 4;
   int sqd0 = distsq(x0, y0);
   if (sqd0 < sqrad) { return sqrad; }
@@ -291,6 +301,21 @@ inline int linear_collide(Vec2 x0, Vec2 y0, Vec2 x1, Vec2 y1, int sqrad) {
   return (sqd0 < sqd1) ? sqd0 : sqd1;
 }
 
+// Given a point moving in a straight line from `p0` to `p1` during a step,
+// returns whether it came within a distance (squared) `sqrad` of the static
+// point `c`, even when it went right through within the step. The closest
+// approach is found by projection on the segment, in 64 bits to avoid
+// overflows.
+constexpr inline bool swept_within(const Vec2& p0, const Vec2& p1, const Vec2& c, int sqrad) {
+  Vec2 d = p1 - p0;
+  Vec2 f = c - p0;
+  long long dot = (long long)x(f) * x(d) + (long long)y(f) * y(d);
+  if (dot <= 0) { return distsq(p0, c) < sqrad; }
+  long long len = magsq(d);
+  if (dot >= len) { return distsq(p1, c) < sqrad; }
+  return (long long)magsq(f) * len - dot * dot < (long long)sqrad * len;
+}
+
 // The basic polar coordinate information, with an angle in degree and a radius
 // equivalent to the distance to the pole. Radius is always positive. If it is
 // found to be negative, program behaviour will be undefined.
@@ -321,24 +346,24 @@ inline std::ostream& operator<< (std::ostream& o, const Ray2& a) {
 }
 
 // Angular norm: angle expressed between [-180, 180]
-inline int anorm(int a) {
+constexpr inline int anorm(int a) {
   a = a % 360;
   return isgv(180 - iabs(a), a, a - isgn(a, 360));
 }
 
-inline Ray2 norm(const Ray2& a) { return {anorm(angle(a)), rad(a)}; }
+constexpr inline Ray2 norm(const Ray2& a) { return {anorm(angle(a)), rad(a)}; }
 
-inline Vec2 vec(const Ray2& a) { return Vec2{ icos(angle(a), rad(a)), isin(angle(a), rad(a)) }; }
-inline Ray2 ray(const Vec2& a) {
+constexpr inline Vec2 vec(const Ray2& a) { return Vec2{ icos(angle(a), rad(a)), isin(angle(a), rad(a)) }; }
+constexpr inline Ray2 ray(const Vec2& a) {
   int r = mag(a);
   return (r == 0) ? Ray2{0, 0} : Ray2{iacos3(x(a), y(a), r), r};
 }
 
 // Angular difference is always expressed between [-180, 180]
-inline int adiff(int a, int b) { return anorm(a - b); }
+constexpr inline int adiff(int a, int b) { return anorm(a - b); }
 
 // Angular distance is always expressed between [0, 180]
-inline int adist(int a, int b) {
+constexpr inline int adist(int a, int b) {
   a = iabs(a - b) % 360;
   return isgv(180 - a, a, 360 - a);
 }
@@ -381,18 +406,192 @@ inline std::ostream& operator<<(std::ostream& o, const Particle& a) {
   return o;
 }
 
-inline Particle linear_motion(const Particle& p) {
+// PackedParticle is a compact particle for search nodes and trajectory
+// buffers: positions, speeds and orientation fit in 16 bits on the maps of the
+// puzzles, while the radius and the mass are constant for each type of unit,
+// given at compile time by `Traits::RADIUS` and `Traits::MASS`, such as:
+//
+//     struct PodTraits {
+//       static constexpr const int RADIUS = 400;
+//       static constexpr const float MASS = .5f;
+//     };
+//
+// The particle accessors work the same, except that `rad` and `mass` can't be
+// assigned and `pos` and `spd` return proxies when the particle is mutable,
+// whose coordinates are assigned with `x` and `y` as usual. Values outside of
+// 16 bits are clamped when packed. A PackedParticle converts to and from a
+// Particle, so it can be passed to `reaction` and the others.
+constexpr inline std::int16_t pack16(int v)
+{ return std::int16_t(imax(INT16_MIN, imin(v, INT16_MAX))); }
+
+struct PackedVec2 {
+  std::int16_t& x;
+  std::int16_t& y;
+  operator Vec2() const { return {x, y}; }
+  PackedVec2& operator= (const Vec2& v)
+  { x = pack16(v.x); y = pack16(v.y); return *this; }
+};
+
+inline std::int16_t& x(const PackedVec2& a) { return a.x; }
+inline std::int16_t& y(const PackedVec2& a) { return a.y; }
+
+template<typename Traits>
+struct PackedParticle {
+  PackedParticle() = default;
+  PackedParticle(const Particle& p)
+    : px(pack16(x(p.pos))), py(pack16(y(p.pos))),
+      vx(pack16(x(p.spd))), vy(pack16(y(p.spd))),
+      orient(pack16(p.orient)) { }
+  operator Particle() const
+  { return {{px, py}, {vx, vy}, orient, Traits::RADIUS, Traits::MASS}; }
+  std::int16_t px, py, vx, vy, orient;
+};
+
+template<typename Traits>
+constexpr inline Vec2 pos(const PackedParticle<Traits>& a) { return {a.px, a.py}; }
+template<typename Traits>
+inline PackedVec2 pos(PackedParticle<Traits>& a) { return {a.px, a.py}; }
+template<typename Traits>
+constexpr inline Vec2 spd(const PackedParticle<Traits>& a) { return {a.vx, a.vy}; }
+template<typename Traits>
+inline PackedVec2 spd(PackedParticle<Traits>& a) { return {a.vx, a.vy}; }
+template<typename Traits>
+constexpr inline int orient(const PackedParticle<Traits>& a) { return a.orient; }
+template<typename Traits>
+constexpr inline std::int16_t& orient(PackedParticle<Traits>& a) { return a.orient; }
+template<typename Traits>
+constexpr inline int rad(const PackedParticle<Traits>&) { return Traits::RADIUS; }
+template<typename Traits>
+constexpr inline float mass(const PackedParticle<Traits>&) { return Traits::MASS; }
+
+// ParticleBatch stores up to N particles as a structure of arrays, so that the
+// same step applied to all of them can use SIMD instructions, which the
+// Particle records don't allow. Vec2Batch holds a vector per particle, such as
+// the thrust. The batch versions of the models give the exact same results as
+// their scalar versions. GCC only vectorizes loops whose length isn't known
+// at compile time from -O3: the batch loops are marked with BATCH_LOOPS so
+// that it weighs them as it would at -O3, at -O2 as well.
+#if defined(__GNUC__) && !defined(__clang__)
+#define BATCH_LOOPS __attribute__((optimize("vect-cost-model=dynamic")))
+#else
+#define BATCH_LOOPS
+#endif
+
+template<unsigned N>
+struct Vec2Batch {
+  alignas(32) std::array<int, N> x, y;
+};
+
+// Ray2Batch holds a polar vector per particle, such as the output of Actions.
+template<unsigned N>
+struct Ray2Batch {
+  alignas(32) std::array<int, N> angle, rad;
+};
+
+template<unsigned N>
+struct ParticleBatch {
+  ParticleBatch() : size(0) { }
+
+  Particle get(unsigned i) const
+  { return {{px[i], py[i]}, {vx[i], vy[i]}, orient[i], rad[i], mass[i]}; }
+
+  void set(unsigned i, const Particle& p) {
+    px[i] = x(pos(p)); py[i] = y(pos(p));
+    vx[i] = x(spd(p)); vy[i] = y(spd(p));
+    orient[i] = ::orient(p); rad[i] = ::rad(p); mass[i] = ::mass(p);
+  }
+
+  template<typename Particles>
+  void load(const Particles& ps) {
+    size = ps.size();
+    for (unsigned i = 0; i < size; ++i) { set(i, ps[i]); }
+  }
+
+  template<typename Particles>
+  void store(Particles& ps) const {
+    for (unsigned i = 0; i < size; ++i) { ps[i] = get(i); }
+  }
+
+  unsigned size;
+  alignas(32) std::array<int, N> px, py, vx, vy, orient, rad;
+  alignas(32) std::array<float, N> mass;
+};
+
+// Integer division through doubles: it vectorizes where integer division
+// doesn't, and is exact as long as both operands are well within 2^52.
+constexpr inline int ddiv(int a, int b) { return int(double(a) / double(b)); }
+
+// Versions of `ihyp`, `isin`, `angle(ray())`, `anorm`, `adiff` and `adist`
+// for batch loops: without branches, and with integer divisions done by
+// `ddiv`. They return the same results.
+constexpr inline int dhyp(int adjacent, int opposite) {
+  int S = sq(adjacent) + sq(opposite);
+  int a = iabs(adjacent), o = iabs(opposite);
+  int x = a + o;
+  x = ddiv(sq(x) + S, 2 * x + 1);
+  x = ddiv(sq(x) + S, 2 * x + 1);
+  x = ddiv(sq(x) + S, 2 * x + 1);
+  return imax(imax(x, a), o);
+}
+
+constexpr inline int dsin(int angle, int scale) {
+  constexpr const int Factor = 81;
+  constexpr const int Factor2 = 54 * sq(Factor);
+  constexpr const float Factor3 = Factor2 * Factor;
+  constexpr const int bits = sizeof(int) * 8;
+  int s = angle >> (bits - 1);
+  int aa = ddiv(((angle^s) - s) * 128 + 45, 90);
+  int h = (aa << (bits - 9)) >> (bits - 1);
+  int q = -((aa >> 7) & 1);                      // second quadrant: 0 or -1
+  int ra = aa & 0x7F;
+  ra = ((ra^q) - q) + (q & 128);                 // 128 - ra in second quadrant
+  float f = float(ra * (Factor2 - (sq(ra) * 8))) / Factor3;
+  ra = scale * f;
+  s = h^s;
+  return (ra^s) - s;
+}
+
+constexpr inline int dcos(int angle, int scale) { return dsin(90 - angle, scale); }
+
+constexpr inline int dangle(int x, int y) {
+  int h = dhyp(x, y);
+  return namp(-h, iacos3(x, y, imax(h, 1)));   // 0 for the null vector
+}
+
+constexpr inline int danorm(int a) {
+  a = a - ddiv(a, 360) * 360;
+  return isgv(180 - iabs(a), a, a - isgn(a, 360));
+}
+
+constexpr inline int dadiff(int a, int b) { return danorm(a - b); }
+
+constexpr inline int dadist(int a, int b) {
+  a = iabs(a - b);
+  a = a - ddiv(a, 360) * 360;
+  return isgv(180 - a, a, 360 - a);
+}
+
+// Batch version of `vec`, for the first `size` rays.
+template<unsigned N>
+BATCH_LOOPS inline void vec(const Ray2Batch<N>& r, Vec2Batch<N>& v, unsigned size) {
+  for (unsigned i = 0; i < size; ++i) {
+    v.x[i] = dcos(r.angle[i], r.rad[i]);
+    v.y[i] = dsin(r.angle[i], r.rad[i]);
+  }
+}
+
+constexpr inline Particle linear_motion(const Particle& p) {
   return {spd(p) + pos(p), spd(p), orient(p), rad(p), mass(p)};
 }
 
-inline Particle reaction(const Particle& p, const Vec2& t) {
+constexpr inline Particle reaction(const Particle& p, const Vec2& t) {
   Vec2 a_ = t / mass(p);
   Vec2 p_ = a_ / 2 + spd(p) + pos(p);
   Vec2 s_ = a_+ spd(p);
   return {p_, s_, orient(p), rad(p), mass(p)};
 }
 
-inline Particle reaction(const Particle& p, const Vec2& t, int iterations) {
+constexpr inline Particle reaction(const Particle& p, const Vec2& t, int iterations) {
   Vec2 a_ = t / mass(p);
   Vec2 p_ = (a_ * sq(iterations)) / 2 + spd(p) * iterations + pos(p);
   Vec2 s_ = a_ * iterations + spd(p);
@@ -407,11 +606,34 @@ inline Particle reaction(const Particle& p, const Vec2& t, int iterations) {
 // realistic, but seem to occur in the puzzles. Mass is ignored in this model.
 struct InstantThrustModel
 {
-  Particle operator() (const Particle& p, const Vec2& t) const {
+  constexpr Particle operator() (const Particle& p, const Vec2& t) const {
     Vec2 s_ = t + spd(p);
     Vec2 p_ = s_ + pos(p);
     return {p_, s_, orient(p), rad(p), mass(p)};
   }
+
+  // The thrust `t`, or the push `r`, with the drag `f`.
+  constexpr Particle operator() (const Particle& p, const Vec2& t, const Vec2& f) const {
+    return (*this)(p, t + f);
+  }
+  constexpr Particle operator() (const Particle& p, const Ray2& r, const Vec2& f) const {
+    return (*this)(p, vec(r) + f);
+  }
+
+  // The same force applied for several turns.
+  constexpr Particle operator() (const Particle& p, const Vec2& t, int iterations) const {
+    Vec2 s_ = t * iterations + spd(p);
+    Vec2 p_ = (t * (iterations * (iterations + 1))) / 2 + spd(p) * iterations + pos(p);
+    return {p_, s_, orient(p), rad(p), mass(p)};
+  }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (ParticleBatch<N>& b, const Vec2Batch<N>& t) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      b.vx[i] += t.x[i]; b.vy[i] += t.y[i];
+      b.px[i] += b.vx[i]; b.py[i] += b.vy[i];
+    }
+  }
 };
 
 // RealisticThrustModel applies the force as if it had pushed the particle
@@ -419,9 +641,53 @@ struct InstantThrustModel
 // instant. This model is closer to reality, hence the name.
 struct RealisticThrustModel
 {
-  Particle operator() (const Particle& p, const Vec2& t) const {
+  constexpr Particle operator() (const Particle& p, const Vec2& t) const {
     return reaction(p, t);
   }
+
+  constexpr Particle operator() (const Particle& p, const Vec2& t, const Vec2& f) const {
+    return reaction(p, t + f);
+  }
+  constexpr Particle operator() (const Particle& p, const Ray2& r, const Vec2& f) const {
+    return reaction(p, vec(r) + f);
+  }
+
+  constexpr Particle operator() (const Particle& p, const Vec2& t, int iterations) const {
+    return reaction(p, t, iterations);
+  }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (ParticleBatch<N>& b, const Vec2Batch<N>& t) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      int ax = int(float(t.x[i]) / b.mass[i]), ay = int(float(t.y[i]) / b.mass[i]);
+      b.px[i] += ax / 2 + b.vx[i]; b.py[i] += ay / 2 + b.vy[i];
+      b.vx[i] += ax; b.vy[i] += ay;
+    }
+  }
+};
+
+// RotationLimitedThrustModel wraps another ThrustModel for particles that can
+// only turn by MAX_ROTATION degree per turn, such as pods in racing puzzles:
+// the particle first rotates toward the heading of the push, within that
+// limit, and the thrust is then applied along its new orientation, with the
+// drag `f`. A push without thrust still rotates the particle, so that it can
+// turn in place. A thrust vector carries no heading when it's zero: the
+// orientation is kept then.
+template<typename ThrustModel, int MAX_ROTATION>
+struct RotationLimitedThrustModel : private ThrustModel
+{
+  constexpr RotationLimitedThrustModel(const ThrustModel& tm = ThrustModel()) : ThrustModel(tm) { }
+
+  constexpr Particle operator() (const Particle& p, const Ray2& r, const Vec2& f) const {
+    int d = adiff(angle(r), orient(p));
+    Particle p_ = p;
+    orient(p_) = anorm(orient(p) + isgn(d, imin(iabs(d), MAX_ROTATION)));
+    return ThrustModel::operator()(p_, vec({orient(p_), rad(r)}) + f);
+  }
+
+  constexpr Particle operator() (const Particle& p, const Vec2& t, const Vec2& f) const {
+    return (t == Vec2{0, 0}) ? ThrustModel::operator()(p, f) : (*this)(p, ray(t), f);
+  }
 };
 
 // Dragmodels functors return the force of drag execrted on a particle in a
@@ -431,7 +697,12 @@ struct RealisticThrustModel
 // for the drag. Good for testing.
 struct VaccumDragModel
 {
-  Vec2 operator() (const Particle&) const { return {0, 0}; }
+  constexpr Vec2 operator() (const Particle&) const { return {0, 0}; }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Vec2Batch<N>& d) const {
+    for (unsigned i = 0; i < b.size; ++i) { d.x[i] = 0; d.y[i] = 0; }
+  }
 };
 
 // This simple model is the most common.
@@ -450,8 +721,97 @@ struct SimpleDragModel
 template<int MAX_THRUST, int MAX_VELOCITY>
 struct BasicDragModel
 {
-  Vec2 operator() (const Particle& p) const {
-    return norm(-spd(p), (mag(spd(p)) * MAX_THRUST) / MAX_VELOCITY);
+  // Same as `norm(-spd(p), (mag(spd(p)) * MAX_THRUST) / MAX_VELOCITY)`, with
+  // the magnitude computed once instead of twice.
+  constexpr Vec2 operator() (const Particle& p) const {
+    int m = mag(spd(p));
+    int n = (m * MAX_THRUST) / MAX_VELOCITY;
+    return {(-x(spd(p)) * n) / (m + 1), (-y(spd(p)) * n) / (m + 1)};
+  }
+
+  // Same as above, with `norm` unrolled, without branches.
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Vec2Batch<N>& d) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      int sx = b.vx[i], sy = b.vy[i];
+      int m = dhyp(sx, sy);
+      int n = ddiv(m * MAX_THRUST, MAX_VELOCITY);
+      d.x[i] = ddiv(-sx * n, m + 1);
+      d.y[i] = ddiv(-sy * n, m + 1);
+    }
+  }
+};
+
+// TabulatedDragModel gives the same results as BasicDragModel, but looks the
+// drag magnitude up in a table built at compile time, for speeds below `SIZE`,
+// saving a division per evaluation. Faster speeds are computed.
+template<int MAX_THRUST, int MAX_VELOCITY, int SIZE = 2 * MAX_VELOCITY>
+struct TabulatedDragModel : BasicDragModel<MAX_THRUST, MAX_VELOCITY>
+{
+  using BasicDragModel<MAX_THRUST, MAX_VELOCITY>::operator();
+
+  constexpr Vec2 operator() (const Particle& p) const {
+    int m = mag(spd(p));
+    int n = (m < SIZE) ? _table.n[m] : (m * MAX_THRUST) / MAX_VELOCITY;
+    return {(-x(spd(p)) * n) / (m + 1), (-y(spd(p)) * n) / (m + 1)};
+  }
+
+private:
+  struct _Table {
+    constexpr _Table() : n() {
+      for (int m = 0; m < SIZE; ++m) { n[m] = (m * MAX_THRUST) / MAX_VELOCITY; }
+    }
+    int n[SIZE];
+  };
+  static constexpr const _Table _table = _Table();
+};
+
+template<int MAX_THRUST, int MAX_VELOCITY, int SIZE>
+constexpr const typename TabulatedDragModel<MAX_THRUST, MAX_VELOCITY, SIZE>::_Table
+TabulatedDragModel<MAX_THRUST, MAX_VELOCITY, SIZE>::_table;
+
+// CollisionModels functors return the speeds of 2 particles after they have
+// come in contact with each other, given their present characteristics and
+// whether either of them is shielded.
+//
+// NoCollisionModel lets particles go through each other, as if they were
+// ghosts. This is the default, and the way all the puzzles were played so far.
+struct NoCollisionModel
+{
+  std::tuple<Particle, Particle>
+  operator() (const Particle& a, const Particle& b, bool = false, bool = false) const
+  { return std::make_tuple(a, b); }
+};
+
+// ElasticCollisionModel is the model of the referee in several racing puzzles:
+// a perfectly elastic bounce, where the impulse is applied in 2 halves and the
+// second half is never less than `MIN_IMPULSE`, so that particles always
+// separate. A shielded particle has its mass multiplied by `SHIELD_FACTOR`.
+//
+// `MIN_IMPULSE` is expressed in the same mass unit as the particles: with pods
+// of mass 1 the referee uses 120, with pods of mass .5 that should be 60.
+template<int MIN_IMPULSE, int SHIELD_FACTOR>
+struct ElasticCollisionModel
+{
+  std::tuple<Particle, Particle>
+  operator() (const Particle& a, const Particle& b,
+              bool shield_a = false, bool shield_b = false) const {
+    float ma = shield_a ? mass(a) * SHIELD_FACTOR : mass(a);
+    float mb = shield_b ? mass(b) * SHIELD_FACTOR : mass(b);
+    Vec2 n = pos(a) - pos(b);
+    float nsq = float(magsq(n));
+    if (nsq == 0.f) { return std::make_tuple(a, b); } // no normal, no bounce
+    float product = float(x(n)) * float(x(spd(a)) - x(spd(b)))
+      + float(y(n)) * float(y(spd(a)) - y(spd(b)));
+    float k = product / (nsq * (ma + mb) / (ma * mb)); // half impulse / |n|
+    float fx = x(n) * k, fy = y(n) * k;
+    float impulse = std::sqrt(fx * fx + fy * fy);
+    float ratio = (impulse < MIN_IMPULSE && impulse > 0.f)
+      ? 1.f + float(MIN_IMPULSE) / impulse : 2.f;    // both halves
+    Particle a_ = a, b_ = b;
+    spd(a_) = {int(x(spd(a)) - fx * ratio / ma), int(y(spd(a)) - fy * ratio / ma)};
+    spd(b_) = {int(x(spd(b)) + fx * ratio / mb), int(y(spd(b)) + fy * ratio / mb)};
+    return std::make_tuple(a_, b_);
   }
 };
 
@@ -459,15 +819,25 @@ struct BasicDragModel
 // break distance under drag in any phyical model.
 struct CoastingAction
 {
-  Ray2 operator() (const Particle& p) const { return {orient(p), 0}; }
+  constexpr Ray2 operator() (const Particle& p) const { return {orient(p), 0}; }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    for (unsigned i = 0; i < b.size; ++i) { r.angle[i] = b.orient[i]; r.rad[i] = 0; }
+  }
 };
 
 // ConstantAction just makes the particle accelerate with a constant thrust
 // applied in the same direction. Good for tests.
 struct ConstantAction
 {
-  ConstantAction(const Vec2& thrust) : _thrust(ray(thrust)) { }
-  Ray2 operator() (const Particle&) const { return _thrust; }
+  constexpr ConstantAction(const Vec2& thrust) : _thrust(ray(thrust)) { }
+  constexpr Ray2 operator() (const Particle&) const { return _thrust; }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    for (unsigned i = 0; i < b.size; ++i) { r.angle[i] = angle(_thrust); r.rad[i] = rad(_thrust); }
+  }
 private:
   Ray2 _thrust;
 };
@@ -477,11 +847,19 @@ private:
 // target is set in the constructor.
 struct TargetAction
 {
-  TargetAction(const Vec2& target, int thrust)
+  constexpr TargetAction(const Vec2& target, int thrust)
     : _target(target), _thrust(thrust) { }
-  Ray2 operator() (const Particle& p) const {
+  constexpr Ray2 operator() (const Particle& p) const {
     return {angle(ray(_target - pos(p))), _thrust};
   }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      r.angle[i] = dangle(x(_target) - b.px[i], y(_target) - b.py[i]);
+      r.rad[i] = _thrust;
+    }
+  }
 private:
   Vec2 _target;
   int _thrust;
@@ -493,8 +871,8 @@ private:
 template<int MAX_THRUST, int MAX_CORRECTION> // maximum correction angle
 struct AdvTargetAction
 {
-  AdvTargetAction(const Vec2& target, int radius) : _target(target), _radius(radius) { }
-  Ray2 operator() (const Particle& p) const {
+  constexpr AdvTargetAction(const Vec2& target, int radius) : _target(target), _radius(radius) { }
+  constexpr Ray2 operator() (const Particle& p) const {
     constexpr const int FULL_COMP_ANGLE = 90;  // angle of full acceleration
     constexpr const int INIT_COMP_ANGLE = 100; // angle of initial acceleration
     if (magsq(spd(p)) < 100)                   // at low speed, straight to target
@@ -516,44 +894,559 @@ struct AdvTargetAction
     else { rad(push) = ((ori_d - (FULL_COMP_ANGLE - abs_d)) * MAX_THRUST) / (INIT_COMP_ANGLE - FULL_COMP_ANGLE); }
     return push;
   }
+
+  // Same as above, for all particles of a batch: every branch is computed and
+  // the result is selected by masks, so that the loop can be vectorized.
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    constexpr const int FULL_COMP_ANGLE = 90;
+    constexpr const int INIT_COMP_ANGLE = 100;
+    const unsigned size = b.size;             // may alias with r otherwise
+    for (unsigned i = 0; i < size; ++i) {
+      int vx = b.vx[i], vy = b.vy[i];
+      int dx = x(_target) - b.px[i], dy = y(_target) - b.py[i];
+      int dir = dangle(dx, dy);
+      int pro = dangle(vx, vy);
+      int slow = sq(vx) + sq(vy) < 100;
+      int arriving = (sq(vx - dx) + sq(vy - dy) < sq(_radius))
+        & (dadist(pro, b.orient[i]) < MAX_CORRECTION);
+      int pro_d = dadiff(dir, pro);
+      int push = dir + amp(FULL_COMP_ANGLE - 1 - iabs(pro_d),
+                           isgn(pro_d, imin(iabs(pro_d), MAX_CORRECTION)));
+      int abs_d = dadist(dir, dangle(dx - vx, dy - vy));
+      int ori_d = dadist(push, b.orient[i]);
+      int thrust = ddiv((ori_d - (FULL_COMP_ANGLE - abs_d)) * MAX_THRUST,
+                        INIT_COMP_ANGLE - FULL_COMP_ANGLE);
+      thrust = isgv(ori_d - (FULL_COMP_ANGLE - abs_d), thrust, MAX_THRUST);
+      thrust = isgv(INIT_COMP_ANGLE - abs_d - ori_d, thrust, 0);
+      r.angle[i] = isgv(-slow, isgv(-arriving, push, pro), dir);
+      r.rad[i] = isgv(-(slow | arriving), thrust, MAX_THRUST);
+    }
+  }
 private:
   Vec2 _target;
   int _radius;
 };
 
-// Physics are modeled with a ThrustModel and a DragModel.
-template<typename ThrustModel, typename DragModel>
-struct Physics : private ThrustModel, DragModel {
-  Physics(const ThrustModel& tm = ThrustModel(),
-          const DragModel& dm = DragModel())
-    : ThrustModel(tm), DragModel(dm) { }
-  const ThrustModel& thrustModel() const { return *this; }
-  const DragModel& dragModel() const { return *this; }
+// Physics are modeled with a ThrustModel, a DragModel and a CollisionModel.
+// Without CollisionModel, particles go through each other.
+template<typename ThrustModel, typename DragModel,
+         typename CollisionModel = NoCollisionModel>
+struct Physics : private ThrustModel, DragModel, CollisionModel {
+  constexpr Physics(const ThrustModel& tm = ThrustModel(),
+                    const DragModel& dm = DragModel(),
+                    const CollisionModel& cm = CollisionModel())
+    : ThrustModel(tm), DragModel(dm), CollisionModel(cm) { }
+  constexpr const ThrustModel& thrustModel() const { return *this; }
+  constexpr const DragModel& dragModel() const { return *this; }
+  constexpr const CollisionModel& collisionModel() const { return *this; }
 };
 
 // `reaction`, `iterate_reaction` and `until_reaction` project actions on
 // particles to compute the future of a particle based on its
 // known present and a phyical model.
-template<typename ThrustModel, typename DragModel>
-inline Particle reaction(const Particle& p, const Vec2& t,
-                         const Physics<ThrustModel, DragModel>& phy) {
-  return phy.thrustModel()(p, t + phy.dragModel()(p));
+//
+// Like the Actions and the models, they are constexpr, so that tables of
+// trajectories, such as braking distances, can be computed by the compiler and
+// cost nothing at run time.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+constexpr inline Particle reaction(const Particle& p, const Vec2& t,
+                                   const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  return phy.thrustModel()(p, t, phy.dragModel()(p));
+}
+
+// Same as above for the push `r` of an Action, which keeps its heading even
+// without thrust. It's a template only so that braced thrusts, such as
+// `reaction(p, {0, 100}, phy)`, still go to the Vec2 version.
+template<typename Push, typename ThrustModel, typename DragModel, typename CollisionModel,
+         typename = typename std::enable_if<std::is_same<Push, Ray2>::value>::type>
+constexpr inline Particle reaction(const Particle& p, const Push& r,
+                                   const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  return phy.thrustModel()(p, r, phy.dragModel()(p));
 }
 
-template<typename Action, typename ThrustModel, typename DragModel>
-inline Particle iterate_reaction(unsigned times, Particle p, const Action& a,
-                                 const Physics<ThrustModel, DragModel>& phy) {
-  for (unsigned i = 0; i < times; ++i) { p = reaction(p, vec(a(p)), phy); }
+// Multi-turn version of `reaction`: the thrust and the drag at present are
+// applied unchanged for several turns. ThrustModels that steer are not
+// supported.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+constexpr inline Particle reaction(const Particle& p, const Vec2& t, int iterations,
+                                   const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  return phy.thrustModel()(p, t + phy.dragModel()(p), iterations);
+}
+
+// Batch version of `reaction`, applying the thrusts `t` to all particles in
+// place. ThrustModels that steer are not supported.
+template<unsigned N, typename ThrustModel, typename DragModel, typename CollisionModel>
+BATCH_LOOPS inline void reaction(ParticleBatch<N>& b, const Vec2Batch<N>& t,
+                     const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  Vec2Batch<N> f;
+  phy.dragModel()(b, f);
+  for (unsigned i = 0; i < b.size; ++i) { f.x[i] += t.x[i]; f.y[i] += t.y[i]; }
+  phy.thrustModel()(b, f);
+}
+
+template<typename Action, typename ThrustModel, typename DragModel, typename CollisionModel>
+constexpr inline Particle iterate_reaction(unsigned times, Particle p, const Action& a,
+                                           const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  for (unsigned i = 0; i < times; ++i) { p = reaction(p, a(p), phy); }
   return p;
 }
 
-template<typename Action, typename ThrustModel, typename DragModel, typename Predicate>
-inline Particle until_reaction(Particle p, const Action& a, const Predicate& t,
-                               const Physics<ThrustModel, DragModel>& phy) {
-  while (!t(p)) { p = reaction(p, vec(a(p)), phy); }
+// Batch version of `iterate_reaction`, for Actions that have a batch version.
+template<unsigned N, typename Action,
+         typename ThrustModel, typename DragModel, typename CollisionModel>
+inline void iterate_reaction(unsigned times, ParticleBatch<N>& b, const Action& a,
+                             const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  Ray2Batch<N> r;
+  Vec2Batch<N> t;
+  for (unsigned i = 0; i < times; ++i) {
+    a(b, r);
+    vec(r, t, b.size);
+    reaction(b, t, phy);
+  }
+}
+
+template<typename Action, typename ThrustModel, typename DragModel, typename CollisionModel,
+         typename Predicate>
+constexpr inline Particle until_reaction(Particle p, const Action& a, const Predicate& t,
+                                         const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  while (!t(p)) { p = reaction(p, a(p), phy); }
+  return p;
+}
+
+// `adaptive_reaction` is `iterate_reaction` for far horizons: while `near(p)`
+// is false, i.e. the particle is far from any checkpoint or other particle, it
+// takes coarse steps of up to `max_step` turns with the multi-turn `reaction`.
+// Each coarse step is checked against 2 steps of half its length, and halved
+// until both agree within `tolerance` units. Near interactions, it takes
+// single steps. `near` should have a margin of a few turns of motion.
+//
+// `tolerance` is per step, and relative to the half steps: it is not a bound
+// on the drift from `iterate_reaction` over the whole horizon. The errors of
+// successive steps add up, and errors on the speed keep growing the error on
+// the position over the following turns. With `max_step` 2, the half steps
+// are single steps, and the result is the same as `iterate_reaction`.
+template<typename Action, typename Predicate,
+         typename ThrustModel, typename DragModel, typename CollisionModel>
+inline Particle adaptive_reaction(unsigned times, Particle p, const Action& a,
+                                  const Predicate& near,
+                                  const Physics<ThrustModel, DragModel, CollisionModel>& phy,
+                                  int tolerance = 16, unsigned max_step = 8) {
+  unsigned k = max_step;
+  while (times > 0) {
+    if (k > times) { k = times; }
+    bool far = !near(p);
+    Particle h = p;
+    for (; far && k > 1; k /= 2) {
+      Particle c = reaction(p, vec(a(p)), k, phy);
+      h = reaction(p, vec(a(p)), k / 2, phy);
+      h = reaction(h, vec(a(h)), k - k / 2, phy);
+      if (distsq(pos(c), pos(h)) <= sq(tolerance) && !near(h)) { break; }
+    }
+    if (far && k > 1) {
+      p = h;
+      times -= k;
+      k = (2 * k < max_step) ? 2 * k : max_step;
+    }
+    else {
+      p = reaction(p, a(p), phy);
+      --times;
+      k = 2;
+    }
+  }
   return p;
 }
 
+// TimeToReach answers many "how many turns until the particle comes within
+// `radius` of the target" queries, with the Action returned by `make(target)`,
+// such as an AdvTargetAction. Answers are capped to `max_turns`.
+//
+//   - a particle moving at most `vmax` per turn needs at least
+//     (distance - radius) / vmax turns: queries that can't make it within
+//     `max_turns` are answered without simulation, and `first` examines
+//     queries by increasing lower bound and stops when none can beat the best,
+//   - the rest is simulated turn by turn, with swept checks so that fast
+//     particles going through the target are caught,
+//   - answers are memoized for the relative position, speed and orientation,
+//     quantized, in a table of CACHE entries. Actions must only depend on
+//     those. Call `clear` each turn to forget them, in O(1).
+//
+// The physics is copied, so it can be built from a temporary.
+template<unsigned CACHE, typename Physics, typename Factory>
+struct TimeToReach {
+  static constexpr const int POS_QUANTUM = 64;
+  static constexpr const int SPD_QUANTUM = 16;
+  static constexpr const int ORIENT_QUANTUM = 4;
+
+  TimeToReach(const Physics& phy, const Factory& make, int radius, int vmax, int max_turns)
+    : hits(0), misses(0), _phy(phy), _make(make), _radius(radius), _vmax(vmax),
+      _max_turns(max_turns), _generation(1) { _cache.fill(_Entry{0, 0, 0}); }
+
+  void clear() { ++_generation; }
+
+  int lower_bound(const Particle& p, const Vec2& target) const {
+    int d = mag(target - pos(p));
+    int gap = d - d / 64 - _radius;
+    return (gap <= 0) ? 0 : (gap + _vmax - 1) / _vmax;
+  }
+
+  int operator() (const Particle& p, const Vec2& target) {
+    return _solve(p, target, _max_turns);
+  }
+
+  // Answers all the queries `(ps[i], targets[i])` in `out[i]`.
+  template<typename Particles, typename Targets, typename Out>
+  void operator() (const Particles& ps, const Targets& targets, Out& out) {
+    for (unsigned i = 0; i < ps.size(); ++i) { out[i] = _solve(ps[i], targets[i], _max_turns); }
+  }
+
+  // Returns the index of the query that reaches its target first, and the
+  // number of turns it needs. Up to N queries: the others are left out.
+  template<unsigned N, typename Particles, typename Targets>
+  std::pair<unsigned, int> first(const Particles& ps, const Targets& targets) {
+    unsigned n = (ps.size() < N) ? unsigned(ps.size()) : N;
+    std::array<std::pair<int, unsigned>, N> order;
+    for (unsigned i = 0; i < n; ++i) { order[i] = std::make_pair(lower_bound(ps[i], targets[i]), i); }
+    std::sort(order.begin(), order.begin() + n);
+    std::pair<unsigned, int> best(n, _max_turns);
+    for (unsigned i = 0; i < n && order[i].first < best.second; ++i) {
+      unsigned k = order[i].second;
+      int t = _solve(ps[k], targets[k], best.second);
+      if (t < best.second || best.first == n) { best = std::make_pair(k, t); }
+    }
+    return best;
+  }
+
+  unsigned hits, misses;
+
+private:
+  struct _Entry { std::uint64_t key; unsigned generation; int turns; };
+
+  // Rounded down, so that all the buckets have the same width, including
+  // the ones around 0.
+  static constexpr int _quantize(int v, int q) { return ((v < 0) ? v - q + 1 : v) / q; }
+
+  static std::uint64_t _key(const Particle& p, const Vec2& target) {
+    Vec2 d = target - pos(p);
+    std::uint64_t k = std::uint64_t(_quantize(x(d), POS_QUANTUM) & 0xfff);
+    k = (k << 12) | std::uint64_t(_quantize(y(d), POS_QUANTUM) & 0xfff);
+    k = (k << 9) | std::uint64_t(_quantize(x(spd(p)), SPD_QUANTUM) & 0x1ff);
+    k = (k << 9) | std::uint64_t(_quantize(y(spd(p)), SPD_QUANTUM) & 0x1ff);
+    k = (k << 9) | std::uint64_t(_quantize(anorm(orient(p)), ORIENT_QUANTUM) & 0x1ff);
+    return k;
+  }
+
+  int _solve(Particle p, const Vec2& target, int limit) {
+    if (lower_bound(p, target) >= limit) { return limit; }
+    std::uint64_t key = _key(p, target);
+    _Entry& e = _cache[(key ^ (key >> 29)) % CACHE];
+    if (e.generation == _generation && e.key == key) { ++hits; return imin(e.turns, limit); }
+    ++misses;
+    auto a = _make(target);
+    int sqrad = sq(_radius);
+    int t = 0;
+    if (distsq(pos(p), target) >= sqrad) {
+      for (t = 1; t <= _max_turns; ++t) {
+        Particle p_ = reaction(p, a(p), _phy);
+        if (swept_within(pos(p), pos(p_), target, sqrad)) { break; }
+        p = p_;
+      }
+      if (t > _max_turns) { t = _max_turns; }
+    }
+    e = _Entry{key, _generation, t};
+    return imin(t, limit);
+  }
+
+  Physics _phy;
+  Factory _make;
+  int _radius, _vmax, _max_turns;
+  unsigned _generation;
+  std::array<_Entry, CACHE> _cache;
+};
+
+template<unsigned CACHE, typename Physics, typename Factory>
+inline TimeToReach<CACHE, Physics, Factory>
+time_to_reach(const Physics& phy, const Factory& make, int radius, int vmax, int max_turns)
+{ return TimeToReach<CACHE, Physics, Factory>(phy, make, radius, vmax, max_turns); }
+
+// `bounce` returns both particles with their speeds after contact, according
+// to the physical model. Particles are expected to be in contact already, as
+// reported by `linear_collide` or `collide_two`.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline std::tuple<Particle, Particle>
+bounce(const Particle& a, const Particle& b,
+       const Physics<ThrustModel, DragModel, CollisionModel>& phy,
+       bool shield_a = false, bool shield_b = false) {
+  return phy.collisionModel()(a, b, shield_a, shield_b);
+}
+
+// CsbPhysics reproduces the referee of Coders Strike Back bit for bit, on the
+// integer state it gives us each turn. It doesn't fit the ThrustModel and
+// DragModel policies since the referee works with doubles during a turn:
+//
+//   - each pod rotates toward its target by at most MAX_ROTATION degree,
+//     except on the first turn where it faces the target straight away,
+//   - the thrust is applied in the exact direction of the pod,
+//   - pods move, bouncing on each other in the order of their collisions, with
+//     the referee's minimum impulse and the mass of shielded pods,
+//   - positions are rounded, speeds are slowed down by FRICTION and truncated,
+//     orientations are rounded.
+//
+// Orientations are in degree within [0, 360), like the referee's.
+struct CsbCommand { Vec2 target; int thrust; bool shield; };
+
+struct CsbPhysics {
+  static constexpr const double MAX_ROTATION = 18.;
+  static constexpr const double FRICTION = .85;
+  static constexpr const double MIN_IMPULSE = 120.;
+  static constexpr const double SHIELD_MASS = 10.;
+  static constexpr const int MAX_COLLISIONS = 64;
+
+  // Orientation of the pod after it rotated toward `target`.
+  static double heading(const Particle& p, const Vec2& target, bool first = false) {
+    double dx = x(target) - x(pos(p)), dy = y(target) - y(pos(p));
+    double d = std::sqrt(dx * dx + dy * dy);
+    if (d == 0.) { return orient(p); }
+    double a = std::acos(dx / d) * 180. / M_PI;
+    if (dy < 0.) { a = 360. - a; }
+    if (first) { return a; }
+    double o = orient(p);
+    double right = (o <= a) ? a - o : 360. - o + a;
+    double left = (o >= a) ? o - a : o + 360. - a;
+    double r = (right < left) ? right : -left;
+    if (r > MAX_ROTATION) { r = MAX_ROTATION; }
+    else if (r < -MAX_ROTATION) { r = -MAX_ROTATION; }
+    o += r;
+    if (o >= 360.) { o -= 360.; }
+    else if (o < 0.) { o += 360.; }
+    return o;
+  }
+
+  // Plays a full turn for all the pods.
+  template<std::size_t N>
+  void operator() (std::array<Particle, N>& pods, const std::array<CsbCommand, N>& cmds,
+                   bool first = false) const {
+    std::array<_Pod, N> ps = _thrust(pods, cmds, first);
+    std::array<bool, N * N> near;
+    near.fill(true);
+    _move(ps, near, 0.);
+    _land(pods, ps);
+  }
+
+  // Same as above, but only the pairs of pods that `schedule`, a
+  // ContactSchedule<N> given all the turns of these pods in order, reports
+  // as possibly in contact are tested for collisions. When a bounce throws a
+  // pod faster than the schedule's bound, all the pairs are tested for the
+  // rest of the turn, and the pod's pairs again at the next one.
+  template<std::size_t N, typename Schedule>
+  void operator() (std::array<Particle, N>& pods, const std::array<CsbCommand, N>& cmds,
+                   Schedule& schedule, bool first = false) const {
+    std::array<_Pod, N> ps = _thrust(pods, cmds, first);
+    // Speeds are rounded away from 0, so that the bound holds for the pods
+    std::array<Particle, N> bound;
+    for (std::size_t i = 0; i < N; ++i) {
+      const _Pod& p = ps[i];
+      bound[i] = {pos(pods[i]), {int(p.vx < 0. ? std::floor(p.vx) : std::ceil(p.vx)),
+                                 int(p.vy < 0. ? std::floor(p.vy) : std::ceil(p.vy))},
+                  0, rad(pods[i]), 1};
+    }
+    std::array<bool, N * N> near;
+    near.fill(false);
+    schedule(bound, [&near](unsigned i, unsigned j) { near[i * N + j] = true; });
+    std::array<bool, N> thrown = _move(ps, near, double(schedule.vmax()));
+    for (std::size_t i = 0; i < N; ++i) { if (thrown[i]) { schedule.wake(unsigned(i)); } }
+    _land(pods, ps);
+  }
+
+  // Plays a turn for a single pod.
+  Particle operator() (const Particle& p, const CsbCommand& cmd, bool first = false) const {
+    std::array<Particle, 1> pods = {{p}};
+    (*this)(pods, std::array<CsbCommand, 1>{{cmd}}, first);
+    return pods[0];
+  }
+
+private:
+  struct _Pod { double x, y, vx, vy, a, r, m; };
+
+  // Pods after their rotation and thrust.
+  template<std::size_t N>
+  static std::array<_Pod, N> _thrust(const std::array<Particle, N>& pods,
+                                     const std::array<CsbCommand, N>& cmds, bool first) {
+    std::array<_Pod, N> ps;
+    for (std::size_t i = 0; i < N; ++i) {
+      const Particle& p = pods[i];
+      double a = heading(p, cmds[i].target, first);
+      double t = cmds[i].shield ? 0. : double(cmds[i].thrust);
+      double ra = a * M_PI / 180.;
+      ps[i] = {double(x(pos(p))), double(y(pos(p))),
+               x(spd(p)) + std::cos(ra) * t, y(spd(p)) + std::sin(ra) * t,
+               a, double(rad(p)), cmds[i].shield ? SHIELD_MASS : 1.};
+    }
+    return ps;
+  }
+
+  // Moves the pods through the turn, bouncing the `near` pairs in the order
+  // of their collisions. With `vmax`, returns the pods that bounces threw
+  // faster than it, once all the pairs are near.
+  template<std::size_t N>
+  static std::array<bool, N> _move(std::array<_Pod, N>& ps, std::array<bool, N * N>& near,
+                                   double vmax) {
+    std::array<bool, N> thrown;
+    thrown.fill(false);
+    double t = 0.;
+    std::size_t li = N, lj = N;           // last collision, not to repeat it
+    for (int k = 0; t < 1.; ++k) {
+      std::size_t ci = N, cj = N;
+      double ct = 1. - t;
+      for (std::size_t i = 0; i < N; ++i) {
+        for (std::size_t j = i + 1; j < N; ++j) {
+          if (k >= MAX_COLLISIONS) { break; } // stuck pods: let them go
+          if (!near[i * N + j]) { continue; }
+          double c = _collision(ps[i], ps[j]);
+          if (c < 0. || (c == 0. && i == li && j == lj)) { continue; }
+          if (c + t < 1. && c < ct) { ct = c; ci = i; cj = j; }
+        }
+      }
+      for (_Pod& p : ps) { p.x += p.vx * ct; p.y += p.vy * ct; }
+      if (ci != N) {
+        _bounce(ps[ci], ps[cj]);
+        for (std::size_t i : {ci, cj}) {
+          if (vmax > 0. && ps[i].vx * ps[i].vx + ps[i].vy * ps[i].vy > vmax * vmax)
+            { thrown[i] = true; near.fill(true); }
+        }
+      }
+      li = ci; lj = cj;
+      t += ct;
+    }
+    return thrown;
+  }
+
+  // Rounds the pods at the end of the turn, and slows them down.
+  template<std::size_t N>
+  static void _land(std::array<Particle, N>& pods, const std::array<_Pod, N>& ps) {
+    for (std::size_t i = 0; i < N; ++i) {
+      const _Pod& p = ps[i];
+      pos(pods[i]) = {int(std::floor(p.x + .5)), int(std::floor(p.y + .5))};
+      spd(pods[i]) = {int(p.vx * FRICTION), int(p.vy * FRICTION)};
+      int o = int(std::floor(p.a + .5));
+      orient(pods[i]) = (o >= 360) ? o - 360 : o;
+    }
+  }
+
+  // Time of the first contact between 2 pods during the rest of the turn, or
+  // a negative value if they don't meet.
+  static double _collision(const _Pod& a, const _Pod& b) {
+    double x = a.x - b.x, y = a.y - b.y;
+    double sr = (a.r + b.r) * (a.r + b.r);
+    if (x * x + y * y < sr) { return 0.; }
+    double vx = a.vx - b.vx, vy = a.vy - b.vy;
+    if (vx == 0. && vy == 0.) { return -1.; }
+    // closest point to the origin on the relative motion line
+    double da = vy, db = -vx;
+    double c1 = da * x + db * y;
+    double det = da * da + db * db;
+    double cx = da * c1 / det, cy = db * c1 / det;
+    double pdist = cx * cx + cy * cy;
+    double mypdist = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+    if (pdist >= sr) { return -1.; }
+    double length = std::sqrt(vx * vx + vy * vy);
+    double backdist = std::sqrt(sr - pdist);
+    cx -= backdist * (vx / length);
+    cy -= backdist * (vy / length);
+    double d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+    if (d2 > mypdist) { return -1.; }
+    double d = std::sqrt(d2);
+    if (d > length) { return -1.; }
+    return d / length;
+  }
+
+  // Pods at the same place have no normal and don't bounce. Pods moving
+  // together get the minimum impulse along the normal, which pushes them
+  // apart, where the referee would divide by 0.
+  static void _bounce(_Pod& a, _Pod& b) {
+    double mcoeff = (a.m + b.m) / (a.m * b.m);
+    double nx = a.x - b.x, ny = a.y - b.y;
+    double nxnysquare = nx * nx + ny * ny;
+    if (nxnysquare == 0.) { return; }
+    double product = nx * (a.vx - b.vx) + ny * (a.vy - b.vy);
+    double fx = (nx * product) / (nxnysquare * mcoeff);
+    double fy = (ny * product) / (nxnysquare * mcoeff);
+    a.vx -= fx / a.m; a.vy -= fy / a.m;
+    b.vx += fx / b.m; b.vy += fy / b.m;
+    double impulse = std::sqrt(fx * fx + fy * fy);
+    if (impulse == 0.) {
+      double n = std::sqrt(nxnysquare);
+      fx = -nx * MIN_IMPULSE / n; fy = -ny * MIN_IMPULSE / n;
+    }
+    else if (impulse < MIN_IMPULSE) { fx = fx * MIN_IMPULSE / impulse; fy = fy * MIN_IMPULSE / impulse; }
+    a.vx -= fx / a.m; a.vy -= fy / a.m;
+    b.vx += fx / b.m; b.vy += fy / b.m;
+  }
+};
+
+// Returns the number of steps during which 2 particles certainly can't touch,
+// given that none of them moves by more than `vmax` in a step: particles at a
+// distance D can't meet for at least D / (2·vmax) steps. The distance is
+// shrunk a little, since `mag` may overestimate it.
+inline int steps_apart(const Particle& a, const Particle& b, int vmax) {
+  int d = mag(pos(a) - pos(b));
+  int gap = d - d / 64 - rad(a) - rad(b);
+  return irel(gap - 1) / (2 * vmax);
+}
+
+// Under BasicDragModel, drag is proportional to speed: a coasting particle
+// loses the same ratio of its speed at each turn and drifts along a geometric
+// series. `coast_ratios` returns that ratio `r`, and the ratio of the
+// previous speed that is travelled during a turn, for each ThrustModel.
+template<int MAX_THRUST, int MAX_VELOCITY>
+inline std::pair<float, float>
+coast_ratios(const Particle&, const InstantThrustModel&,
+             const BasicDragModel<MAX_THRUST, MAX_VELOCITY>&) {
+  float r = 1.f - float(MAX_THRUST) / float(MAX_VELOCITY);
+  return std::make_pair(r, r);
+}
+
+template<int MAX_THRUST, int MAX_VELOCITY>
+inline std::pair<float, float>
+coast_ratios(const Particle& p, const RealisticThrustModel&,
+             const BasicDragModel<MAX_THRUST, MAX_VELOCITY>&) {
+  float k = float(MAX_THRUST) / (float(MAX_VELOCITY) * mass(p));
+  return std::make_pair(1.f - k, 1.f - k / 2.f);
+}
+
+// `coast`, `turns_to_speed` and `stop_distance` are the closed forms of
+// `iterate_reaction` and `until_reaction` with CoastingAction: they answer in
+// constant time for any number of turns. They don't truncate at each turn
+// like the integer steps do, so they drift apart by a few units over time, and
+// slow particles do come to a stop.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline Particle coast(const Particle& p, unsigned turns,
+                      const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  std::pair<float, float> rf = coast_ratios(p, phy.thrustModel(), phy.dragModel());
+  float rn = std::pow(rf.first, float(turns));
+  float sum = rf.second * (1.f - rn) / (1.f - rf.first);
+  return {pos(p) + spd(p) * sum, spd(p) * rn, orient(p), rad(p), mass(p)};
+}
+
+// Number of turns for the particle to slow down to `speed` or less, which
+// must be positive.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline unsigned turns_to_speed(const Particle& p, int speed,
+                               const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  int m = mag(spd(p));
+  if (m <= speed) { return 0; }
+  std::pair<float, float> rf = coast_ratios(p, phy.thrustModel(), phy.dragModel());
+  return unsigned(std::ceil(std::log(float(speed) / float(m)) / std::log(rf.first)));
+}
+
+// Distance travelled by the particle until it stops.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline int stop_distance(const Particle& p,
+                         const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  std::pair<float, float> rf = coast_ratios(p, phy.thrustModel(), phy.dragModel());
+  return int(float(mag(spd(p))) * rf.second / (1.f - rf.first));
+}
+
 // Collision Detection algorithm. Returns the distance of collision, an a
 // posteriori estimate of the closest approach between 2 particles (squared)
 // and the time to collision. When closest approach <= distance of collision,
@@ -566,29 +1459,161 @@ inline Particle until_reaction(Particle p, const Action& a, const Predicate& t,
 // particles. At each turn, the model is updated with the particles' positions,
 // and it queries the thrust for each of the particles.
 //
+// When `vmax`, the highest speed of the particles, is known, steps where they
+// can't touch are not checked, although the particles are still moved, and
+// the estimation stops as soon as they can't touch anymore before max_iter. Particles found faster than `vmax` are
+// checked at each step until they slow down. Collisions are found at the
+// same time as without `vmax`, but when there is none the closest approach
+// only covers the steps that were checked: it is no closer than the exact
+// one, and shouldn't be used to rank near misses.
 template<typename ActionA, typename ActionB, typename Physics>
 inline std::tuple<int, int, int>
 collide_two(Particle a0, Particle b0, const ActionA& ma, const ActionB& mb,
             const Physics& phy, int max_iter = 100,
-            const Box2& bb = {{-10000,-10000}, {10000, 10000}}) {
+            const Box2& bb = {{-10000,-10000}, {10000, 10000}}, int vmax = 0) {
   int sqrad = sq(rad(a0)) + sq(rad(b0));
   int best_approach = distsq(pos(a0), pos(b0));
   if (best_approach <= sqrad)
     { return std::make_tuple(sqrad, best_approach, 0); }
+  int wait = (vmax > 0) ? steps_apart(a0, b0, vmax) : 0;
+  if (wait >= max_iter)
+    { return std::make_tuple(sqrad, best_approach, max_iter); }
   int i = 0;
   for (; i < max_iter; ++i) {
-    Particle a1 = reaction(a0, vec(ma(a0)), phy);
-    Particle b1 = reaction(b0, vec(mb(b0)), phy);
+    Particle a1 = reaction(a0, ma(a0), phy);
+    Particle b1 = reaction(b0, mb(b0), phy);
     if (!within(bb, pos(a1)) || !within(bb, pos(b1))) break;
+    if (wait > 0 && magsq(spd(a1)) <= sq(vmax) && magsq(spd(b1)) <= sq(vmax))
+      { --wait; a0 = a1; b0 = b1; continue; }
     int approach = linear_collide(pos(a0), pos(b0), pos(a1), pos(b1), sqrad);
     if (approach <= sqrad)
       { return std::make_tuple(sqrad, approach, i); }
     if (approach < best_approach) { best_approach = approach; }
+    if (vmax > 0) {
+      wait = steps_apart(a1, b1, vmax);
+      if (i + 1 + wait >= max_iter)
+        { return std::make_tuple(sqrad, best_approach, max_iter); }
+    }
     a0 = a1; b0 = b1;
   }
   return std::make_tuple(sqrad, best_approach, i);
 }
 
+// ContactSchedule is a cache for all-pairs checks between N particles over
+// consecutive steps (or turns). It keeps, for each pair, the earliest step at
+// which both particles could possibly touch, and only emits the pairs that
+// reached it. The earliest step is only refreshed when it is reached, or when
+// either particle was found faster than `vmax`, so most pairs cost nothing
+// most of the time.
+template<unsigned N>
+struct ContactSchedule {
+  explicit ContactSchedule(int vmax) : _vmax(vmax), _step(0) { _earliest.fill(0); }
+
+  // Calls `fn(i, j)` for each pair that could touch during the next step,
+  // given the particles at the start of the step, then moves on to the next.
+  // Only the first N particles are scheduled.
+  template<typename Particles, typename Fn>
+  void operator() (const Particles& ps, Fn fn) {
+    unsigned n = (ps.size() < N) ? unsigned(ps.size()) : N;
+    std::array<bool, N> fast;
+    for (unsigned i = 0; i < n; ++i) { fast[i] = magsq(spd(ps[i])) > sq(_vmax); }
+    for (unsigned i = 0; i < n; ++i) {
+      for (unsigned j = i + 1; j < n; ++j) {
+        int& earliest = _earliest[i * N + j];
+        if (earliest > _step && !fast[i] && !fast[j]) { continue; }
+        fn(i, j);
+        // Fast particles may move by more than `vmax` during this step
+        earliest = _step + ((fast[i] || fast[j]) ? 1 : imax(1, steps_apart(ps[i], ps[j], _vmax)));
+      }
+    }
+    ++_step;
+  }
+
+  int vmax() const { return _vmax; }
+
+  // Emits all the pairs of particle `i` at the next step, e.g. when it moved
+  // faster than `vmax` during the last one.
+  void wake(unsigned i) {
+    for (unsigned j = 0; j < N; ++j) { _earliest[(i < j) ? i * N + j : j * N + i] = 0; }
+  }
+
+  // Forget all the cached steps, e.g. when particles are teleported.
+  void reset() { _earliest.fill(0); _step = 0; }
+
+private:
+  int _vmax;
+  int _step;
+  std::array<int, N * N> _earliest;
+};
+
+// SweepAndPrune is a broad phase for collisions between many particles. It
+// sorts the extents swept by each particle during a step along the x axis, and
+// only emits the pairs of particles whose extents overlap on both axes, as
+// candidates for the narrow phase (`linear_collide`), instead of all n² pairs.
+//
+// The ordering is kept between steps and repaired with an insertion sort, which
+// is close to O(n) since particles move coherently from one step to the
+// next. It is reset whenever the number of particles changes. Up to N particles
+// can be tracked, the others are left out, and no memory is allocated.
+template<unsigned N>
+struct SweepAndPrune {
+  SweepAndPrune() : _size(0) { }
+
+  // Calls `fn(i, j)` for each candidate pair of indices, given the particles
+  // at the start of the step `p0` and at the end of the step `p1`.
+  template<typename Particles, typename Fn>
+  void operator() (const Particles& p0, const Particles& p1, Fn fn) {
+    _resize(p0.size());
+    for (unsigned i = 0; i < _size; ++i)
+      { _extent(i, pos(p0[i]), pos(p1[i]), rad(p0[i])); }
+    _sweep(fn);
+  }
+
+  // Same as above, for particles in linear motion during the step.
+  template<typename Particles, typename Fn>
+  void operator() (const Particles& ps, Fn fn) {
+    _resize(ps.size());
+    for (unsigned i = 0; i < _size; ++i)
+      { _extent(i, pos(ps[i]), pos(ps[i]) + spd(ps[i]), rad(ps[i])); }
+    _sweep(fn);
+  }
+
+private:
+  void _resize(unsigned n) {
+    if (n > N) { n = N; }
+    if (n == _size) { return; }
+    for (unsigned i = 0; i < n; ++i) { _order[i] = i; }
+    _size = n;
+  }
+
+  void _extent(unsigned i, const Vec2& a, const Vec2& b, int r) {
+    _low[i] = {imin(x(a), x(b)) - r, imin(y(a), y(b)) - r};
+    _high[i] = {imax(x(a), x(b)) + r, imax(y(a), y(b)) + r};
+  }
+
+  template<typename Fn>
+  void _sweep(Fn& fn) {
+    for (unsigned i = 1; i < _size; ++i) {
+      unsigned k = _order[i];
+      unsigned j = i;
+      for (; j > 0 && x(_low[_order[j - 1]]) > x(_low[k]); --j)
+        { _order[j] = _order[j - 1]; }
+      _order[j] = k;
+    }
+    for (unsigned i = 0; i < _size; ++i) {
+      unsigned a = _order[i];
+      for (unsigned j = i + 1; j < _size && x(_low[_order[j]]) <= x(_high[a]); ++j) {
+        unsigned b = _order[j];
+        if (y(_low[b]) <= y(_high[a]) && y(_low[a]) <= y(_high[b])) { fn(a, b); }
+      }
+    }
+  }
+
+  unsigned _size;
+  std::array<unsigned, N> _order;
+  std::array<Vec2, N> _low, _high;
+};
+
 // Ring & Anchor are 2 simple objects that store objects in a contiguous location
 // and then rotate addressing to each objects stored.
 //
@@ -664,4 +1689,162 @@ template<unsigned P, typename Tp, unsigned N>
 inline typename Ring<Tp, N>::template Anchor<P> anchor(Ring<Tp, N>& r)
 { return typename Ring<Tp, N>::template Anchor<P>(r); }
 
+// ThreadPool spreads batches of independent tasks, such as rollouts or
+// evaluations, across `threads` workers and the calling thread. Each worker
+// owns a deque of tasks: it takes the last task it was given first, and
+// steals the first task of the others when it runs out, so that uneven tasks
+// still keep every core busy.
+//
+// A task is a range of indices of a batch, and a batch lives on the stack of
+// the caller; each deque is a ring of up to N tasks, and tasks that don't fit
+// run on the caller. Submitting a batch never allocates. Batches are
+// submitted by one thread at a time, which takes part in them until they're
+// done. With no worker, batches simply run on the calling thread.
+template<unsigned N = 256>
+struct ThreadPool {
+  explicit ThreadPool(unsigned threads) : _deques(new _Deque[threads]), _size(threads) {
+    _threads.reserve(threads);
+    for (unsigned w = 0; w < threads; ++w) { _threads.emplace_back([this, w] { _work(w); }); }
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ~ThreadPool() {
+    { std::lock_guard<std::mutex> lock(_sleep); _stop = true; }
+    _wake.notify_all();
+    for (std::thread& t : _threads) { t.join(); }
+  }
+
+  unsigned size() const { return _size; }
+
+  // Calls `fn(i)` for each index `i` in [0, n), in tasks of `grain`
+  // consecutive indices, and returns once all are done.
+  template<typename Fn>
+  void for_each(int n, Fn fn, int grain = 1) {
+    auto range = [&fn](int begin, int end) { for (int i = begin; i < end; ++i) { fn(i); } };
+    _submit(n, grain, range);
+  }
+
+  // Returns the index `i` in [0, n) with the highest `score(i)`, or -1 if n is
+  // 0. Ties go to the lowest index, so that the result doesn't depend on the
+  // scheduling of tasks. The best score is written to `value`, if any.
+  template<typename Score, typename Tp = decltype(std::declval<Score&>()(0))>
+  int best(int n, Score score, int grain = 1, Tp* value = nullptr) {
+    int best = -1;
+    Tp top = Tp();
+    std::mutex merge;
+    auto range = [&](int begin, int end) {
+      int b = begin;
+      Tp v = score(begin);
+      for (int i = begin + 1; i < end; ++i) {
+        Tp s = score(i);
+        if (v < s) { v = s; b = i; }
+      }
+      std::lock_guard<std::mutex> lock(merge);
+      if (best < 0 || top < v || (!(v < top) && b < best)) { best = b; top = v; }
+    };
+    _submit(n, grain, range);
+    if (value && best >= 0) { *value = top; }
+    return best;
+  }
+
+private:
+  struct _Batch {
+    void (*run)(void*, int, int);
+    void* fn;
+    std::atomic<int> pending;
+  };
+
+  struct _Task {
+    _Batch* batch;
+    int begin, end;
+  };
+
+  struct _Deque {
+    bool push(const _Task& t) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_size == N) { return false; }
+      _tasks[(_front + _size++) % N] = t;
+      return true;
+    }
+
+    bool back(_Task& t) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_size == 0) { return false; }
+      t = _tasks[(_front + --_size) % N];
+      return true;
+    }
+
+    bool front(_Task& t) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_size == 0) { return false; }
+      t = _tasks[_front];
+      _front = (_front + 1) % N;
+      --_size;
+      return true;
+    }
+
+  private:
+    std::mutex _mutex;
+    std::array<_Task, N> _tasks;
+    unsigned _front = 0, _size = 0;
+  };
+
+  template<typename Range>
+  static void _run(void* fn, int begin, int end) { (*static_cast<Range*>(fn))(begin, end); }
+
+  template<typename Range>
+  void _submit(int n, int grain, Range& range) {
+    if (n <= 0) { return; }
+    if (_size == 0) { range(0, n); return; }
+    _Batch b;
+    b.run = &_run<Range>;
+    b.fn = &range;
+    b.pending.store((n + grain - 1) / grain, std::memory_order_relaxed);
+    unsigned w = 0;
+    for (int begin = 0; begin < n; begin += grain) {
+      _Task t = {&b, begin, std::min(n, begin + grain)};
+      _queued.fetch_add(1);
+      if (!_deques[w].push(t)) { _queued.fetch_sub(1); _execute(t); }
+      if (++w == size()) { w = 0; }
+    }
+    { std::lock_guard<std::mutex> lock(_sleep); }
+    _wake.notify_all();
+    while (b.pending.load(std::memory_order_acquire) > 0) {
+      _Task t;
+      if (_take(size(), t)) { _execute(t); } else { std::this_thread::yield(); }
+    }
+  }
+
+  // Takes a task from the back of the deque of worker `w`, or steals one
+  // from the front of another deque.
+  bool _take(unsigned w, _Task& t) {
+    bool found = w < size() && _deques[w].back(t);
+    for (unsigned k = 1; !found && k <= size(); ++k) { found = _deques[(w + k) % size()].front(t); }
+    if (found) { _queued.fetch_sub(1); }
+    return found;
+  }
+
+  static void _execute(const _Task& t) {
+    t.batch->run(t.batch->fn, t.begin, t.end);
+    t.batch->pending.fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  void _work(unsigned w) {
+    for (;;) {
+      _Task t;
+      if (_take(w, t)) { _execute(t); continue; }
+      std::unique_lock<std::mutex> lock(_sleep);
+      _wake.wait(lock, [this] { return _stop || _queued.load() > 0; });
+      if (_stop) { return; }
+    }
+  }
+
+  std::unique_ptr<_Deque[]> _deques;
+  const unsigned _size;
+  std::vector<std::thread> _threads;
+  std::atomic<int> _queued{0};
+  std::mutex _sleep;
+  std::condition_variable _wake;
+  bool _stop = false;
+};
+
 #endif // SYLVAIN__CODINGAME_INCLUDED
@@ -145,3 +145,261 @@ BOOST_AUTO_TEST_CASE(test_sine){
 
   BOOST_CHECK_GT(elapsed_std.count(), elapsed_my.count());
 }
+
+// Bodies moving coherently at random in the arena, bouncing on its walls.
+template<size_t N>
+inline std::vector<Particle> random_bodies() {
+  std::vector<Particle> v(N);
+  random_int r;
+  for (Particle& p : v)
+    { p = {{r() % 20000 - 10000, r() % 20000 - 10000}, {r() % 600 - 300, r() % 600 - 300}, 0, 400, 1}; }
+  return v;
+}
+
+inline void move_bodies(std::vector<Particle>& v) {
+  for (Particle& p : v) {
+    p = linear_motion(p);
+    if (iabs(x(pos(p))) > 10000) { x(spd(p)) = -x(spd(p)); }
+    if (iabs(y(pos(p))) > 10000) { y(spd(p)) = -y(spd(p)); }
+  }
+}
+
+inline bool narrow_phase(const Particle& a, const Particle& b) {
+  int sqrad = sq(rad(a) + rad(b));
+  return linear_collide(pos(a), pos(b), pos(a) + spd(a), pos(b) + spd(b), sqrad) <= sqrad;
+}
+
+template<size_t N>
+inline void sweep_and_prune_vs_all_pairs() {
+  constexpr const int STEPS = 100;
+  const std::vector<Particle> bodies(random_bodies<N>());
+
+  std::chrono::duration<double> elapsed_pairs;
+  {
+    int j = 0;
+    std::vector<Particle> v(bodies);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < STEPS; ++s) {
+      for (size_t a = 0; a < N; ++a)
+        for (size_t b = a + 1; b < N; ++b) { j += narrow_phase(v[a], v[b]); }
+      move_bodies(v);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed_pairs = end-start;
+    std::cout << "all pairs elapsed time for " << N << " bodies, " << STEPS << " steps:\t"
+              << elapsed_pairs.count() << "s (" << j << ")" << std::endl;
+  }
+
+  std::chrono::duration<double> elapsed_sap;
+  {
+    int j = 0;
+    std::vector<Particle> v(bodies);
+    SweepAndPrune<N> sap;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < STEPS; ++s) {
+      sap(v, [&](unsigned a, unsigned b) { j += narrow_phase(v[a], v[b]); });
+      move_bodies(v);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed_sap = end-start;
+    std::cout << "sweep and prune elapsed time for " << N << " bodies, " << STEPS << " steps:\t"
+              << elapsed_sap.count() << "s (" << j << ")" << std::endl;
+  }
+
+  if (N >= 64) { BOOST_CHECK_GT(elapsed_pairs.count(), elapsed_sap.count()); }
+}
+
+BOOST_AUTO_TEST_CASE(test_sweep_and_prune){
+  sweep_and_prune_vs_all_pairs<8>();
+  sweep_and_prune_vs_all_pairs<32>();
+  sweep_and_prune_vs_all_pairs<128>();
+  sweep_and_prune_vs_all_pairs<512>();
+}
+
+// Pods chasing random targets over the map, played by CsbPhysics with and
+// without a ContactSchedule for the pairs.
+template<size_t N>
+inline void csb_schedule_vs_all_pairs() {
+  constexpr const int TURNS = 2000;
+  CsbPhysics csb;
+  random_int r;
+  std::array<Particle, N> pods;
+  for (Particle& p : pods) { p = {{r() % 16000 - 8000, r() % 9000 - 4500}, {0, 0}, 0, 400, 1}; }
+  std::vector<std::array<CsbCommand, N>> cmds(TURNS);
+  for (auto& turn : cmds)
+    for (CsbCommand& c : turn) { c = {{r() % 16000 - 8000, r() % 9000 - 4500}, r() % 101, false}; }
+
+  std::chrono::duration<double> elapsed_pairs;
+  std::array<Particle, N> a(pods);
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < TURNS; ++t) { csb(a, cmds[t]); }
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed_pairs = end-start;
+    std::cout << "CsbPhysics all pairs turns per second for " << N << " pods:\t"
+              << TURNS / elapsed_pairs.count() << " (" << pos(a[0]) << ")" << std::endl;
+  }
+
+  std::chrono::duration<double> elapsed_schedule;
+  std::array<Particle, N> b(pods);
+  {
+    ContactSchedule<N> cs(700);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < TURNS; ++t) { csb(b, cmds[t], cs); }
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed_schedule = end-start;
+    std::cout << "CsbPhysics scheduled turns per second for " << N << " pods:\t"
+              << TURNS / elapsed_schedule.count() << " (" << pos(b[0]) << ")" << std::endl;
+  }
+
+  BOOST_CHECK(a == b);
+  if (N >= 32) { BOOST_CHECK_GT(elapsed_pairs.count(), elapsed_schedule.count()); }
+}
+
+BOOST_AUTO_TEST_CASE(test_csb_schedule){
+  csb_schedule_vs_all_pairs<4>();
+  csb_schedule_vs_all_pairs<8>();
+  csb_schedule_vs_all_pairs<32>();
+}
+
+// Pairs of bodies chasing targets: with a speed bound, collide_two stops as
+// soon as they can't touch anymore.
+BOOST_AUTO_TEST_CASE(test_collide_two_vmax){
+  constexpr const int N = 2048;
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> phy;
+  AdvTargetAction<100, 45> a({0, 0}, 600), b({3000, 0}, 600);
+  std::vector<Particle> bodies(random_bodies<N>());
+  int hits[2] = {0, 0};
+  for (int vmax : {0, 700}) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i + 1 < N; i += 2) {
+      auto c = collide_two(bodies[i], bodies[i + 1], a, b, phy, 30, {{-20000, -20000}, {20000, 20000}}, vmax);
+      hits[vmax > 0] += std::get<1>(c) <= std::get<0>(c);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end-start;
+    std::cout << "collide_two() per second with vmax " << vmax << ":\t"
+              << N / 2 / elapsed.count() << " (" << hits[vmax > 0] << ")" << std::endl;
+  }
+  // Particles are still moved at each step, so the gain is small
+  BOOST_CHECK_EQUAL(hits[0], hits[1]);
+}
+
+// Times `steps` particle steps by `scalar()` and by `batch()`, which return
+// a position to print, and checks that the batch is faster. It's only faster
+// when the batch loops are vectorized, which BATCH_LOOPS ensures with GCC
+// from -O2.
+template<typename Scalar, typename Batch>
+inline void batch_vs_scalar(const char* name, int steps, Scalar scalar, Batch batch) {
+  std::chrono::duration<double> elapsed_scalar;
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    Vec2 p = scalar();
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed_scalar = end-start;
+    std::cout << "scalar " << name << " steps per second:\t"
+              << steps / elapsed_scalar.count() << " (" << p << ")" << std::endl;
+  }
+
+  std::chrono::duration<double> elapsed_batch;
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    Vec2 p = batch();
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed_batch = end-start;
+    std::cout << "batch " << name << " steps per second:\t"
+              << steps / elapsed_batch.count() << " (" << p << ")" << std::endl;
+  }
+
+  BOOST_CHECK_GT(elapsed_scalar.count(), elapsed_batch.count());
+}
+
+BOOST_AUTO_TEST_CASE(test_particle_batch){
+  constexpr const int N = 1024;
+  constexpr const int STEPS = 1000;
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> phy;
+  std::vector<Particle> bodies(random_bodies<N>());
+  Vec2Batch<N> t;
+  random_int r;
+  for (int i = 0; i < N; ++i) { t.x[i] = r() % 200 - 100; t.y[i] = r() % 200 - 100; }
+  batch_vs_scalar("reaction()", N * STEPS,
+                  [&] {
+                    std::vector<Particle> v(bodies);
+                    for (int s = 0; s < STEPS; ++s)
+                      for (int i = 0; i < N; ++i) { v[i] = reaction(v[i], {t.x[i], t.y[i]}, phy); }
+                    return pos(v[0]);
+                  },
+                  [&] {
+                    ParticleBatch<N> b;
+                    b.load(bodies);
+                    for (int s = 0; s < STEPS; ++s) { reaction(b, t, phy); }
+                    return pos(b.get(0));
+                  });
+}
+
+template<typename DragModel>
+inline double drag_per_second(const char* name, const DragModel& drag,
+                              std::vector<Particle> bodies) {
+  constexpr const int ROUNDS = 1000;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < ROUNDS; ++r)
+    for (Particle& p : bodies) { spd(p) = spd(p) + drag(p) + Vec2{1, 1}; }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end-start;
+  double rate = bodies.size() * ROUNDS / elapsed.count();
+  std::cout << name << " per second:\t" << rate << " (" << spd(bodies[0]) << ")" << std::endl;
+  return rate;
+}
+
+BOOST_AUTO_TEST_CASE(test_drag){
+  std::vector<Particle> bodies(random_bodies<1024>());
+  random_int r;
+  for (Particle& p : bodies) { spd(p) = {r() % 1400 - 700, r() % 1400 - 700}; }
+  auto naive = [](const Particle& p) { return norm(-spd(p), (mag(spd(p)) * 100) / 660); };
+  double n = drag_per_second("norm() drag\t", naive, bodies);
+  double b = drag_per_second("BasicDragModel\t", BasicDragModel<100, 660>(), bodies);
+  drag_per_second("TabulatedDragModel", TabulatedDragModel<100, 660>(), bodies);
+  BOOST_CHECK_GT(b, n);
+}
+
+BOOST_AUTO_TEST_CASE(test_batch_action){
+  constexpr const int N = 1024;
+  constexpr const int STEPS = 100;
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> phy;
+  AdvTargetAction<100, 45> action({8000, 4500}, 600);
+  std::vector<Particle> bodies(random_bodies<N>());
+  batch_vs_scalar("AdvTargetAction", N * STEPS,
+                  [&] {
+                    std::vector<Particle> v(bodies);
+                    for (int i = 0; i < N; ++i) { v[i] = iterate_reaction(STEPS, v[i], action, phy); }
+                    return pos(v[0]);
+                  },
+                  [&] {
+                    ParticleBatch<N> b;
+                    b.load(bodies);
+                    iterate_reaction(STEPS, b, action, phy);
+                    return pos(b.get(0));
+                  });
+}
+
+BOOST_AUTO_TEST_CASE(test_thread_pool){
+  constexpr const int N = 4096;
+  constexpr const int STEPS = 200;
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> phy;
+  AdvTargetAction<100, 45> action({8000, 4500}, 600);
+  std::vector<Particle> bodies(random_bodies<N>());
+  auto rollout = [&](int i) { return -distsq(pos(iterate_reaction(STEPS, bodies[i], action, phy)), {8000, 4500}); };
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  int serial = -1;
+  for (unsigned threads : {0u, cores - 1}) {
+    ThreadPool<> pool(threads);
+    auto start = std::chrono::high_resolution_clock::now();
+    int best = pool.best(N, rollout, 64);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end-start;
+    std::cout << "rollouts per second with " << threads + 1 << " thread(s):\t"
+              << N / elapsed.count() << " (" << best << ")" << std::endl;
+    if (serial < 0) { serial = best; }
+    BOOST_CHECK_EQUAL(best, serial);
+  }
+}
@@ -248,3 +248,509 @@ BOOST_AUTO_TEST_CASE(test_collide_two) {
   BOOST_CHECK_NE(std::get<1>(collide_two(x0, x1, TargetAction({0, -2000}, 20), TargetAction({0, 2000}, 20), model3)),
                  sq(500) + sq(500));
 }
+
+BOOST_AUTO_TEST_CASE(test_bounce) {
+  // 2 particles in contact, facing each other
+  Particle a = {{-400, 0}, {100, 0}, 0, 400, 1};
+  Particle b = {{400, 0}, {-100, 0}, 180, 400, 1};
+  Physics<InstantThrustModel, VaccumDragModel> ghost;
+  BOOST_CHECK_EQUAL(std::get<0>(bounce(a, b, ghost)), a);
+  BOOST_CHECK_EQUAL(std::get<1>(bounce(a, b, ghost)), b);
+  Physics<InstantThrustModel, VaccumDragModel, ElasticCollisionModel<120, 10>> model;
+  // The first half stops both, the second half is raised to the minimum impulse
+  BOOST_CHECK_EQUAL(spd(std::get<0>(bounce(a, b, model))), Vec2({-120, 0}));
+  BOOST_CHECK_EQUAL(spd(std::get<1>(bounce(a, b, model))), Vec2({120, 0}));
+  // The shielded particle is heavier, and barely slows down
+  BOOST_CHECK_EQUAL(spd(std::get<0>(bounce(a, b, model, false, true))), Vec2({-263, 0}));
+  BOOST_CHECK_EQUAL(spd(std::get<1>(bounce(a, b, model, false, true))), Vec2({-63, 0}));
+}
+
+BOOST_AUTO_TEST_CASE(test_sweep_and_prune) {
+  // A grid of particles, each heading toward its neighbour on the right
+  std::array<Particle, 16> ps;
+  for (int i = 0; i < 16; ++i)
+    { ps[i] = {{(i % 4) * 1000 - 2000, (i / 4) * 3000}, {(i % 2) ? -200 : 200, 0}, 0, 400, 1}; }
+  SweepAndPrune<16> sap;
+  for (int step = 0; step < 4; ++step) {
+    int brute = 0, swept = 0;
+    for (int i = 0; i < 16; ++i)
+      for (int j = i + 1; j < 16; ++j)
+        if (linear_collide(pos(ps[i]), pos(ps[j]), pos(ps[i]) + spd(ps[i]),
+                           pos(ps[j]) + spd(ps[j]), sq(800)) <= sq(800)) { ++brute; }
+    sap(ps, [&](unsigned i, unsigned j) {
+        if (linear_collide(pos(ps[i]), pos(ps[j]), pos(ps[i]) + spd(ps[i]),
+                           pos(ps[j]) + spd(ps[j]), sq(800)) <= sq(800)) { ++swept; }
+      });
+    // The broad phase never misses a collision found by the narrow phase
+    if (step == 0) { BOOST_CHECK_GT(brute, 0); }
+    BOOST_CHECK_EQUAL(brute, swept);
+    for (Particle& p : ps) { p = linear_motion(p); }
+  }
+  // Particles beyond N are left out instead of overflowing the arrays
+  SweepAndPrune<2> small;
+  int pairs = 0;
+  small(ps, [&](unsigned i, unsigned j) { ++pairs; BOOST_CHECK(i < 2 && j < 2); });
+  BOOST_CHECK_EQUAL(pairs, 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_swept_within) {
+  // Ends in the circle, or starts in it
+  BOOST_CHECK(swept_within(Vec2({-2000, 0}), Vec2({-100, 0}), Vec2({0, 0}), sq(600)));
+  BOOST_CHECK(swept_within(Vec2({100, 0}), Vec2({2000, 0}), Vec2({0, 0}), sq(600)));
+  // Goes through the circle within a step, at high speed
+  BOOST_CHECK(swept_within(Vec2({-1000, 500}), Vec2({1000, 500}), Vec2({0, 0}), sq(600)));
+  // Passes by the circle
+  BOOST_CHECK(!swept_within(Vec2({-1000, 700}), Vec2({1000, 700}), Vec2({0, 0}), sq(600)));
+  // Points toward the circle, but stops short
+  BOOST_CHECK(!swept_within(Vec2({-2000, 0}), Vec2({-700, 0}), Vec2({0, 0}), sq(600)));
+  // Does not move
+  BOOST_CHECK(swept_within(Vec2({10, 0}), Vec2({10, 0}), Vec2({0, 0}), sq(600)));
+  BOOST_CHECK(!swept_within(Vec2({1000, 0}), Vec2({1000, 0}), Vec2({0, 0}), sq(600)));
+}
+
+BOOST_AUTO_TEST_CASE(test_steps_apart) {
+  Particle a = {{-5000, 0}, {0, 0}, 0, 400, 1};
+  Particle b = {{5000, 0}, {0, 0}, 0, 400, 1};
+  // 10000 apart, minus the radii: 9200 to cover at 2 * 500 per step
+  BOOST_CHECK_LE(steps_apart(a, b, 500), 9);
+  BOOST_CHECK_GE(steps_apart(a, b, 500), 8);
+  BOOST_CHECK_EQUAL(steps_apart(a, a, 500), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_collide_two_vmax) {
+  // Same result with or without speed bound
+  Particle x0 = {{-10000, 0}, {100, 0}, 0, 500, 1};
+  Particle x1 = {{10000, 0}, {-100, 0}, 0, 500, 1};
+  Physics<InstantThrustModel, VaccumDragModel> model1;
+  Box2 bb = {{-10000,-10000}, {10001, 10001}};
+  BOOST_CHECK(collide_two(x0, x1, CoastingAction(), CoastingAction(), model1, 100, bb)
+              == collide_two(x0, x1, CoastingAction(), CoastingAction(), model1, 100, bb, 100));
+  BOOST_CHECK(collide_two(x0, x1, TargetAction({0, 2000}, 10), TargetAction({0, 2000}, 10), model1, 100, bb)
+              == collide_two(x0, x1, TargetAction({0, 2000}, 10), TargetAction({0, 2000}, 10), model1, 100, bb, 1000));
+  // They can't meet within 10 steps, so the estimation stops right away
+  BOOST_CHECK_EQUAL(std::get<2>(collide_two(x0, x1, CoastingAction(), CoastingAction(), model1, 10, bb, 100)), 10);
+  // Near misses: no collision either way, and the closest approach with the
+  // speed bound is never closer than the exact one
+  for (int y = 1000; y <= 9000; y += 2000) {
+    Particle y1 = {{10000, y}, {-100, 0}, 0, 500, 1};
+    auto exact = collide_two(x0, y1, CoastingAction(), CoastingAction(), model1, 100, bb);
+    auto bound = collide_two(x0, y1, CoastingAction(), CoastingAction(), model1, 100, bb, 100);
+    BOOST_CHECK_GT(std::get<1>(exact), std::get<0>(exact));
+    BOOST_CHECK_GT(std::get<1>(bound), std::get<0>(bound));
+    BOOST_CHECK_GE(std::get<1>(bound), std::get<1>(exact));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_contact_schedule_bound) {
+  // Particles beyond N are left out instead of overflowing the schedule
+  std::array<Particle, 4> ps;
+  for (int i = 0; i < 4; ++i) { ps[i] = {{i * 100, 0}, {0, 0}, 0, 400, 1}; }
+  ContactSchedule<2> cs(300);
+  int checked = 0;
+  cs(ps, [&](unsigned i, unsigned j) { ++checked; BOOST_CHECK(i < 2 && j < 2); });
+  BOOST_CHECK_EQUAL(checked, 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_contact_schedule) {
+  // Pairs of particles heading toward each other, at various distances
+  std::array<Particle, 8> ps;
+  for (int i = 0; i < 8; ++i)
+    { ps[i] = {{(i % 2) ? 1000 * i : -1000 * i, i * 100}, {(i % 2) ? -300 : 300, 0}, 0, 400, 1}; }
+  ContactSchedule<8> cs(300);
+  int checked = 0, brute = 0, scheduled = 0;
+  for (int step = 0; step < 20; ++step) {
+    for (int i = 0; i < 8; ++i)
+      for (int j = i + 1; j < 8; ++j)
+        if (linear_collide(pos(ps[i]), pos(ps[j]), pos(ps[i]) + spd(ps[i]),
+                           pos(ps[j]) + spd(ps[j]), sq(800)) <= sq(800)) { ++brute; }
+    cs(ps, [&](unsigned i, unsigned j) {
+        ++checked;
+        if (linear_collide(pos(ps[i]), pos(ps[j]), pos(ps[i]) + spd(ps[i]),
+                           pos(ps[j]) + spd(ps[j]), sq(800)) <= sq(800)) { ++scheduled; }
+      });
+    for (Particle& p : ps) { p = linear_motion(p); }
+  }
+  BOOST_CHECK_GT(brute, 0);
+  BOOST_CHECK_EQUAL(brute, scheduled);
+  BOOST_CHECK_LT(checked, 20 * 28);
+}
+
+BOOST_AUTO_TEST_CASE(test_coast) {
+  Particle x0 = {{-5000, 0}, {600, 300}, 0, 400, 1};
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> model1;
+  Physics<RealisticThrustModel, BasicDragModel<100, 660>> model2;
+  // The closed form stays close to the iterations
+  for (unsigned turns : {1u, 2u, 5u, 10u}) {
+    Particle a = coast(x0, turns, model1);
+    Particle b = iterate_reaction(turns, x0, CoastingAction(), model1);
+    BOOST_CHECK_LT(mag(pos(a) - pos(b)), 5 * int(turns));
+    BOOST_CHECK_LE(mag(spd(a) - spd(b)), int(turns) + 1);
+    a = coast(x0, turns, model2);
+    b = iterate_reaction(turns, x0, CoastingAction(), model2);
+    BOOST_CHECK_LT(mag(pos(a) - pos(b)), 5 * int(turns));
+    BOOST_CHECK_LE(mag(spd(a) - spd(b)), int(turns) + 1);
+  }
+  BOOST_CHECK_EQUAL(turns_to_speed(x0, 1000, model1), 0u);
+  unsigned n = turns_to_speed(x0, 100, model1);
+  BOOST_CHECK_LE(mag(spd(iterate_reaction(n, x0, CoastingAction(), model1))), 105);
+  BOOST_CHECK_GT(mag(spd(iterate_reaction(n - 1, x0, CoastingAction(), model1))), 100);
+  // Stops after the distance travelled in a long time; the integer steps drag
+  // a little less and go a bit further.
+  int d = stop_distance(x0, model1);
+  BOOST_CHECK_LT(iabs(d - mag(pos(coast(x0, 1000, model1)) - pos(x0))), 10);
+  n = turns_to_speed(x0, 10, model1);
+  BOOST_CHECK_LT(iabs(d - mag(pos(iterate_reaction(n, x0, CoastingAction(), model1)) - pos(x0))),
+                 d / 10);
+}
+
+// Turns played with the rules of the Coders Strike Back referee (doubles
+// during the turn, rounded positions, truncated speeds after friction). The
+// expected values come from a separate port of those rules, not from replays
+// of the game, so they can't catch a rule that both got wrong.
+BOOST_AUTO_TEST_CASE(test_csb_physics) {
+  CsbPhysics csb;
+  auto pod = [](int x, int y, int vx, int vy, int o)
+    { return Particle{{x, y}, {vx, vy}, o, 400, 1}; };
+  auto check = [](const Particle& p, const Particle& e) {
+    BOOST_CHECK_EQUAL(pos(p), pos(e));
+    BOOST_CHECK_EQUAL(spd(p), spd(e));
+    BOOST_CHECK_EQUAL(orient(p), orient(e));
+  };
+  // Straight, rotation clamped, first turn, boost, coasting
+  check(csb(pod(-5000, 0, 0, 0, 0), {{5000, 0}, 100, false}), pod(-4900, 0, 85, 0, 0));
+  check(csb(pod(-5000, 0, 300, -120, 0), {{0, 5000}, 100, false}), pod(-4605, -89, 335, -75, 18));
+  check(csb(pod(-5000, 0, 0, 0, 0), {{0, 5000}, 100, false}, true), pod(-4929, 71, 60, 60, 45));
+  check(csb(pod(1234, -2345, -321, 77, 200), {{-3000, -4000}, 650, false}),
+        pod(308, -2505, -787, -135, 201));
+  check(csb(pod(-7, 3, -13, -11, 359), {{0, 0}, 0, false}), pod(-20, -8, -11, -9, 341));
+  // Head on, then with a shield
+  std::array<Particle, 2> two = {{pod(-700, 0, 300, 0, 0), pod(700, 0, -300, 0, 180)}};
+  csb(two, {{{{5000, 0}, 100, false}, {{-5000, 0}, 100, false}}});
+  check(two[0], pod(-500, 0, -340, 0, 0));
+  check(two[1], pod(500, 0, 340, 0, 180));
+  two = {{pod(-700, 40, 300, 0, 0), pod(700, 0, -300, 0, 180)}};
+  csb(two, {{{{5000, 0}, 100, false}, {{-5000, 0}, 100, true}}});
+  check(two[0], pod(-480, 48, -739, 52, 0));
+  check(two[1], pod(418, -1, -147, -5, 180));
+  // Chain of collisions within the same turn
+  std::array<Particle, 4> four = {{pod(-700, 0, 300, 0, 0), pod(700, 0, -300, 0, 180),
+                                   pod(0, 900, 0, -400, 270), pod(3000, 3000, 0, 0, 0)}};
+  csb(four, {{{{5000, 0}, 100, false}, {{-5000, 0}, 100, false},
+              {{0, -5000}, 100, false}, {{0, 0}, 0, true}}});
+  check(four[0], pod(-483, -238, 8, -431, 0));
+  check(four[1], pod(436, -177, -93, -320, 180));
+  check(four[2], pod(47, 815, 85, 326, 270));
+  check(four[3], pod(3000, 3000, 0, 0, 342));
+  // Overlapping pods moving together are pushed apart, and pods at the same
+  // place go through each other
+  two = {{pod(0, 0, 100, 0, 0), pod(600, 0, 100, 0, 0)}};
+  csb(two, {{{{5000, 0}, 0, false}, {{5000, 0}, 0, false}}});
+  check(two[0], pod(-20, 0, -17, 0, 0));
+  check(two[1], pod(820, 0, 187, 0, 0));
+  two = {{pod(0, 0, 100, 0, 0), pod(0, 0, 100, 0, 0)}};
+  csb(two, {{{{5000, 0}, 0, false}, {{5000, 0}, 0, false}}});
+  check(two[0], pod(100, 0, 85, 0, 0));
+  check(two[1], pod(100, 0, 85, 0, 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_csb_physics_schedule) {
+  // A crowd of pods, some boosting, played with and without a schedule
+  CsbPhysics csb;
+  unsigned seed = 12345;
+  auto rnd = [&seed](int n) { seed = seed * 1103515245u + 12345u; return int((seed >> 8) % unsigned(n)); };
+  std::array<Particle, 8> exact, scheduled;
+  for (int i = 0; i < 8; ++i)
+    { exact[i] = {{rnd(12000) - 6000, rnd(8000) - 4000}, {0, 0}, rnd(360), 400, 1}; }
+  scheduled = exact;
+  ContactSchedule<8> cs(700);
+  for (int turn = 0; turn < 300; ++turn) {
+    std::array<CsbCommand, 8> cmds;
+    for (CsbCommand& c : cmds)
+      { c = {{rnd(6000) - 3000, rnd(6000) - 3000}, (rnd(20) == 0) ? 650 : rnd(101), rnd(30) == 0}; }
+    csb(exact, cmds, turn == 0);
+    csb(scheduled, cmds, cs, turn == 0);
+    BOOST_REQUIRE(exact == scheduled);
+    for (int i = 0; i < 8; ++i)
+      { BOOST_REQUIRE_EQUAL(orient(exact[i]), orient(scheduled[i])); }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_rotation_limited) {
+  // Facing right, asked to go up
+  Particle x0 = {{0, 0}, {0, 0}, 0, 400, 1};
+  Physics<RotationLimitedThrustModel<InstantThrustModel, 18>, VaccumDragModel> model;
+  Particle x1 = reaction(x0, {0, 100}, model);
+  BOOST_CHECK_EQUAL(orient(x1), 18);
+  BOOST_CHECK_LT(iabs(angle(ray(spd(x1))) - 18), 2);
+  // Gets there in the end, then no further
+  BOOST_CHECK_EQUAL(orient(iterate_reaction(5, x0, ConstantAction({0, 100}), model)), 90);
+  BOOST_CHECK_EQUAL(orient(iterate_reaction(8, x0, ConstantAction({0, 100}), model)), 90);
+  // Same on the other side, across the back
+  x0 = {{0, 0}, {0, 0}, 170, 400, 1};
+  BOOST_CHECK_EQUAL(orient(reaction(x0, {0, -100}, model)), -172);
+  // Coasting keeps the orientation
+  BOOST_CHECK_EQUAL(orient(iterate_reaction(3, x0, CoastingAction(), model)), 170);
+  // A push without thrust turns in place
+  BOOST_CHECK_EQUAL(orient(reaction(x0, Ray2{90, 0}, model)), 152);
+  BOOST_CHECK_EQUAL(spd(reaction(x0, Ray2{90, 0}, model)), Vec2({0, 0}));
+}
+
+BOOST_AUTO_TEST_CASE(test_rotation_limited_target) {
+  // Going away from the target, and facing away from it: AdvTargetAction turns
+  // without thrust first, then goes for it.
+  Physics<RotationLimitedThrustModel<InstantThrustModel, 18>, BasicDragModel<100, 660>> model;
+  AdvTargetAction<100, 45> action({6000, 0}, 600);
+  Particle p = {{0, 0}, {-300, 0}, 180, 400, 1};
+  BOOST_CHECK_EQUAL(rad(action(p)), 0);
+  BOOST_CHECK_NE(orient(reaction(p, action(p), model)), 180);
+  int turns = 0;
+  for (; turns < 100 && distsq(pos(p), {6000, 0}) > sq(600); ++turns)
+    { p = reaction(p, action(p), model); }
+  BOOST_CHECK_LT(turns, 100);
+}
+
+// Particles scattered at various speeds, orientations and masses.
+template<std::size_t M>
+std::array<Particle, M> scattered_particles() {
+  std::array<Particle, M> ps;
+  for (int i = 0; i < int(M); ++i) {
+    ps[i] = {{i * 311 - 30000, 9000 - i * 97}, {(i * 53) % 900 - 450, (i * 71) % 900 - 450},
+             (i * 37) % 540 - 180, 400, (i % 3) ? 1.f : .5f};
+  }
+  return ps;
+}
+
+// Checks that `batch(b)` moves the particles `ps` loaded in a batch of N
+// exactly as `scalar(i, p)` moves each of them.
+template<unsigned N, std::size_t M, typename Scalar, typename Batch>
+void check_batch(const std::array<Particle, M>& ps, const Scalar& scalar, const Batch& batch) {
+  ParticleBatch<N> b;
+  b.load(ps);
+  batch(b);
+  for (unsigned i = 0; i < M; ++i) { BOOST_CHECK_EQUAL(b.get(i), scalar(i, ps[i])); }
+}
+
+template<typename Physics>
+void check_batch_reaction(const Physics& phy) {
+  Vec2Batch<64> t;
+  for (int i = 0; i < 37; ++i) {
+    t.x[i] = (i * 17) % 200 - 100;
+    t.y[i] = (i * 29) % 200 - 100;
+  }
+  check_batch<64>(scattered_particles<37>(),
+                  [&](unsigned i, Particle p) {
+                    for (int step = 0; step < 10; ++step) { p = reaction(p, {t.x[i], t.y[i]}, phy); }
+                    return p;
+                  },
+                  [&](ParticleBatch<64>& b) {
+                    for (int step = 0; step < 10; ++step) { reaction(b, t, phy); }
+                  });
+}
+
+BOOST_AUTO_TEST_CASE(test_particle_batch) {
+  check_batch_reaction(Physics<InstantThrustModel, BasicDragModel<100, 660>>());
+  check_batch_reaction(Physics<RealisticThrustModel, BasicDragModel<100, 660>>());
+  check_batch_reaction(Physics<RealisticThrustModel, VaccumDragModel>());
+}
+
+template<typename Action>
+void check_batch_action(const Action& a) {
+  std::array<Particle, 200> ps = scattered_particles<200>();
+  ps[0] = {{5000, 3000}, {0, 0}, 0, 400, 1};          // on target, no speed
+  ps[1] = {{4800, 3000}, {150, 10}, 0, 400, 1};       // about to arrive
+  ParticleBatch<256> b;
+  b.load(ps);
+  Ray2Batch<256> r;
+  a(b, r);
+  for (int i = 0; i < 200; ++i) { BOOST_CHECK_EQUAL((Ray2{r.angle[i], r.rad[i]}), a(ps[i])); }
+  Vec2Batch<256> v;
+  vec(r, v, b.size);
+  for (int i = 0; i < 200; ++i) { BOOST_CHECK_EQUAL((Vec2{v.x[i], v.y[i]}), vec(a(ps[i]))); }
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> model;
+  check_batch<256>(ps, [&](unsigned, const Particle& p) { return iterate_reaction(10, p, a, model); },
+                   [&](ParticleBatch<256>& c) { iterate_reaction(10, c, a, model); });
+}
+
+BOOST_AUTO_TEST_CASE(test_batch_action) {
+  check_batch_action(CoastingAction());
+  check_batch_action(ConstantAction({30, -40}));
+  check_batch_action(TargetAction({5000, 3000}, 100));
+  check_batch_action(AdvTargetAction<100, 45>({5000, 3000}, 600));
+  check_batch_action(AdvTargetAction<200, 18>({-2000, 0}, 300));
+}
+
+struct TestPodTraits {
+  static constexpr const int RADIUS = 400;
+  static constexpr const float MASS = .5f;
+};
+
+BOOST_AUTO_TEST_CASE(test_packed_particle) {
+  typedef PackedParticle<TestPodTraits> Pod;
+  BOOST_CHECK_LE(sizeof(Pod), 16u);
+  Particle x0 = {{-10000, 8000}, {-650, 320}, -170, 400, .5f};
+  Pod p(x0);
+  BOOST_CHECK_EQUAL(Particle(p), x0);
+  BOOST_CHECK_EQUAL(pos(p), pos(x0));
+  BOOST_CHECK_EQUAL(spd(p), spd(x0));
+  BOOST_CHECK_EQUAL(orient(p), orient(x0));
+  BOOST_CHECK_EQUAL(rad(p), 400);
+  BOOST_CHECK_EQUAL(mass(p), .5f);
+  // Accessors can be assigned
+  pos(p) = Vec2{1, 2};
+  spd(p) = pos(x0);
+  orient(p) = 90;
+  BOOST_CHECK_EQUAL(x(pos(p)), 1);
+  BOOST_CHECK_EQUAL(spd(p), pos(x0));
+  BOOST_CHECK_EQUAL(orient(Particle(p)), 90);
+  x(pos(p)) = 3;
+  y(spd(p)) = -4;
+  BOOST_CHECK_EQUAL(pos(p), Vec2({3, 2}));
+  BOOST_CHECK_EQUAL(y(spd(Particle(p))), -4);
+  // Out of range values are clamped
+  spd(p) = Vec2{40000, -40000};
+  BOOST_CHECK_EQUAL(spd(p), Vec2({32767, -32768}));
+  BOOST_CHECK_EQUAL(pos(Pod(Particle({{-50000, 50000}, {0, 0}, 0, 400, .5f}))), Vec2({-32768, 32767}));
+  // And used in the physics
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> model;
+  p = x0;
+  p = reaction(p, {100, 0}, model);
+  BOOST_CHECK_EQUAL(Particle(p), reaction(x0, {100, 0}, model));
+}
+
+BOOST_AUTO_TEST_CASE(test_adaptive_reaction) {
+  Particle x0 = {{-8000, 0}, {300, 0}, 0, 400, 1};
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> model1;
+  Physics<RealisticThrustModel, VaccumDragModel> model2;
+  auto never = [](const Particle&) { return false; };
+  auto always = [](const Particle&) { return true; };
+  // Always near something: the same as single steps
+  BOOST_CHECK_EQUAL(adaptive_reaction(30, x0, TargetAction({8000, 0}, 100), always, model1),
+                    iterate_reaction(30, x0, TargetAction({8000, 0}, 100), model1));
+  // In vaccum under constant thrust, coarse steps only differ by rounding
+  BOOST_CHECK_LT(distsq(pos(adaptive_reaction(30, x0, ConstantAction({10, 0}), never, model2)),
+                        pos(iterate_reaction(30, x0, ConstantAction({10, 0}), model2))),
+                 sq(16));
+  // With steps of 2 turns, half steps are single steps
+  Particle x1 = {{-8000, 0}, {550, 0}, 0, 400, 1};
+  TargetAction target({8000, 0}, 100);
+  BOOST_CHECK_EQUAL(adaptive_reaction(20, x1, target, never, model1, 16, 2),
+                    iterate_reaction(20, x1, target, model1));
+  // A coarse step is kept within the tolerance of its half steps, and halved
+  // otherwise
+  Particle coarse = reaction(x1, vec(target(x1)), 8, model1);
+  BOOST_CHECK_LE(distsq(pos(adaptive_reaction(8, x1, target, never, model1, 100)), pos(coarse)),
+                 sq(100));
+  BOOST_CHECK_GT(distsq(pos(adaptive_reaction(8, x1, target, never, model1, 16)), pos(coarse)),
+                 sq(16));
+  // Near the target, single steps take over
+  auto close = [](const Particle& p) { return x(pos(p)) > -6000; };
+  BOOST_CHECK_EQUAL(adaptive_reaction(20, x1, target, close, model1),
+                    iterate_reaction(20, x1, target, model1));
+}
+
+BOOST_AUTO_TEST_CASE(test_time_to_reach) {
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> model;
+  auto make = [](const Vec2& t) { return TargetAction(t, 100); };
+  auto ttr = time_to_reach<256>(model, make, 600, 700, 30);
+  Particle x0 = {{-5000, 0}, {0, 0}, 0, 400, 1};
+  Vec2 target = {5000, 0};
+  int expected = 0;
+  Particle p = x0;
+  while (distsq(pos(p), target) >= sq(600))
+    { p = reaction(p, vec(TargetAction(target, 100)(p)), model); ++expected; }
+  BOOST_CHECK_EQUAL(ttr(x0, target), expected);
+  // Translated: same relative position, answered from the cache
+  Particle x1 = x0;
+  pos(x1) = pos(x1) + Vec2{0, 1024};
+  BOOST_CHECK_EQUAL(ttr(x1, target + Vec2{0, 1024}), expected);
+  BOOST_CHECK_EQUAL(ttr.hits, 1u);
+  // Too far to reach within 30 turns, answered without simulation
+  BOOST_CHECK_EQUAL(ttr(x0, Vec2{30000, 0}), 30);
+  BOOST_CHECK_EQUAL(ttr.misses, 1u);
+  // The first of several queries
+  std::array<Particle, 3> ps = {{x0, x0, x0}};
+  std::array<Vec2, 3> ts = {{Vec2{5000, 0}, Vec2{-3000, 0}, Vec2{0, 4000}}};
+  std::array<int, 3> out;
+  ttr.clear();
+  ttr(ps, ts, out);
+  std::pair<unsigned, int> f = ttr.first<3>(ps, ts);
+  BOOST_CHECK_EQUAL(f.first, 1u);
+  BOOST_CHECK_EQUAL(f.second, out[1]);
+  BOOST_CHECK_LT(out[1], out[0]);
+  BOOST_CHECK_LT(out[1], out[2]);
+  // Built from a temporary physics
+  auto tmp = time_to_reach<256>(Physics<InstantThrustModel, BasicDragModel<100, 660>>(), make, 600, 700, 30);
+  BOOST_CHECK_EQUAL(tmp(x0, target), expected);
+  // Buckets of the same width on both sides of 0
+  Particle x2 = {{0, 0}, {0, 0}, 0, 400, 1};
+  tmp.hits = 0;
+  tmp(x2, Vec2{10, 2000});
+  tmp(x2, Vec2{50, 2000});
+  BOOST_CHECK_EQUAL(tmp.hits, 1u);
+  tmp(x2, Vec2{-10, 2000});
+  BOOST_CHECK_EQUAL(tmp.hits, 1u);
+  tmp(x2, Vec2{-60, 2000});
+  BOOST_CHECK_EQUAL(tmp.hits, 2u);
+  // Queries beyond N are left out
+  BOOST_CHECK_EQUAL(ttr.first<1>(ps, ts).first, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_tabulated_drag) {
+  BasicDragModel<100, 660> basic;
+  TabulatedDragModel<100, 660> tabulated;
+  for (int vx = -1500; vx <= 1500; vx += 7)
+    for (int vy = -1500; vy <= 1500; vy += 11) {
+      Particle p = {{0, 0}, {vx, vy}, 0, 400, 1};
+      BOOST_CHECK_EQUAL(tabulated(p), norm(-spd(p), (mag(spd(p)) * 100) / 660));
+      BOOST_CHECK_EQUAL(basic(p), tabulated(p));
+    }
+}
+
+struct BrakingTable {
+  constexpr BrakingTable() : distance() {
+    constexpr Physics<InstantThrustModel, BasicDragModel<100, 660>> phy;
+    for (int s = 0; s < 16; ++s) {
+      Particle p = {{0, 0}, {s * 50, 0}, 0, 400, 1};
+      distance[s] = x(pos(iterate_reaction(20, p, CoastingAction(), phy)));
+    }
+  }
+  int distance[16];
+};
+
+BOOST_AUTO_TEST_CASE(test_constexpr) {
+  constexpr Physics<RotationLimitedThrustModel<InstantThrustModel, 18>,
+                    BasicDragModel<100, 660>> phy;
+  constexpr Particle x0 = {{0, 0}, {300, -200}, 90, 400, 1};
+  constexpr Particle x1 = iterate_reaction(10, x0, AdvTargetAction<100, 45>({5000, 3000}, 600), phy);
+  Particle p = x0;
+  for (int i = 0; i < 10; ++i) { p = reaction(p, AdvTargetAction<100, 45>({5000, 3000}, 600)(p), phy); }
+  BOOST_CHECK_EQUAL(x1, p);
+  BOOST_CHECK_EQUAL(orient(x1), orient(p));
+  constexpr BrakingTable braking;
+  static_assert(braking.distance[0] == 0, "no speed, no distance");
+  static_assert(braking.distance[15] > braking.distance[14], "faster goes further");
+  Physics<InstantThrustModel, BasicDragModel<100, 660>> model;
+  for (int s = 0; s < 16; ++s)
+    BOOST_CHECK_EQUAL(braking.distance[s],
+                      x(pos(iterate_reaction(20, Particle{{0, 0}, {s * 50, 0}, 0, 400, 1},
+                                             CoastingAction(), model))));
+  constexpr Ray2 r = ray(Vec2{-300, 400});
+  static_assert(iabs(rad(r) - 500) <= 2, "ray");
+  BOOST_CHECK_EQUAL(angle(r), iacos3(-300, 400, 500));
+  BOOST_CHECK_EQUAL(vec(r), vec(ray(Vec2{-300, 400})));
+}
+
+BOOST_AUTO_TEST_CASE(test_thread_pool) {
+  for (unsigned threads : {0u, 1u, 3u}) {
+    ThreadPool<4> pool(threads); // small deques, so that some tasks overflow
+    std::vector<int> hits(1000, 0);
+    pool.for_each(hits.size(), [&hits](int i) { ++hits[i]; }, 7);
+    BOOST_CHECK(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }));
+    // 6 equal bests: the first one wins, whichever task finds it.
+    auto score = [](int i) { return (i % 100 == 42) ? 10 : i % 10; };
+    int value = 0;
+    BOOST_CHECK_EQUAL(pool.best(1000, score, 3, &value), 42);
+    BOOST_CHECK_EQUAL(value, 10);
+    BOOST_CHECK_EQUAL(pool.best(0, score), -1);
+  }
+}
@@ -2,9 +2,19 @@
 #define SYLVAIN__CODINGAME_INCLUDED
 
 #include <tuple>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
 #include <cmath>
 #include <array>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 // This is the canonical implementation for absolute. It's so beautiful, I
 // wanted to write it again. It just blows my mind everytime I look at it.
@@ -110,7 +120,7 @@ constexpr inline Tp sq(Tp x) { return x * x; }
 //   - start at the Manhattan magnitude (a.k.a taxicab metric)
 //   - we know values are necessarily positive, so add +1 to avoid div by 0
 //   - do 3 iterations of Newton's method
-inline int ihyp(const int adjacent, const int opposite)
+constexpr inline int ihyp(const int adjacent, const int opposite)
 {
   int S = sq(adjacent) + sq(opposite);
   int a = iabs(adjacent), o = iabs(opposite);
@@ -129,7 +139,7 @@ inline int ihyp(const int adjacent, const int opposite)
 // of sign and quadrant to use: sin(x) or sin(90 - x).
 //
 // It should have less than 2% of error.
-inline int isin(int angle, int scale) {
+constexpr inline int isin(int angle, int scale) {
   constexpr const int Factor = 81;               // 256 / PI ~= 81
   constexpr const int Factor2 = 54 * sq(Factor); // 9 * 3! * (256/PI ~= 81)^2
   constexpr const float Factor3 = Factor2 * Factor;
@@ -145,7 +155,7 @@ inline int isin(int angle, int scale) {
   return (ra^s) - s;
 }
 
-inline int icos(int angle, int scale) {
+constexpr inline int icos(int angle, int scale) {
   return isin(90 - angle, scale);
 }
 
@@ -172,7 +182,7 @@ inline int icos(int angle, int scale) {
 //
 // Note that if `hypot` is 0, the result is undefined. `hypot` is assumed to be
 // properly computed, and in particular, always greater than `x`.
-inline int iacos3(int x, int y, int hypot) {
+constexpr inline int iacos3(int x, int y, int hypot) {
   constexpr const float A = -53.807358428;
   constexpr const float B = 52.814341583;
   constexpr const float C = -1.284590624;
@@ -188,7 +198,7 @@ inline int iacos3(int x, int y, int hypot) {
 // Return an angle in degree for the value of the adjacent length `x`, the
 // opposite length`y` with less than 0.5% error.
 //
-inline int iacos2(int x, int y) {
+constexpr inline int iacos2(int x, int y) {
   return iacos3(x, y, ihyp(x, y));
 }
 
@@ -225,10 +235,10 @@ constexpr inline Vec2 operator* (const Vec2& a, float factor)
 constexpr inline Vec2 operator/ (const Vec2& a, float factor)
 { return {int(float(x(a)) / factor), int(float(y(a)) / factor)}; }
 
-inline Vec2 operator<< (const Vec2& a, int factor)
+constexpr inline Vec2 operator<< (const Vec2& a, int factor)
 { return {x(a) << factor, y(a) << factor}; }
 
-inline Vec2 operator>> (const Vec2& a, int factor)
+constexpr inline Vec2 operator>> (const Vec2& a, int factor)
 { return {x(a) >> factor, y(a) >> factor}; }
 
 constexpr inline bool operator== (const Vec2& a, const Vec2& b)
@@ -239,17 +249,17 @@ constexpr inline bool operator!= (const Vec2& a, const Vec2& b) { return !(a ==
 constexpr inline int magsq(const Vec2& a)
 { return sq(x(a)) + sq(y(a)); }
 
-inline int distsq(const Vec2& a, const Vec2& b)
+constexpr inline int distsq(const Vec2& a, const Vec2& b)
 { return magsq(a - b); }
 
-inline int mag(const Vec2& a) { return ihyp(x(a), y(a)); }
+constexpr inline int mag(const Vec2& a) { return ihyp(x(a), y(a)); }
 
 // Similar to mag, normalize cares to:
 //
 //   - avoid overflows/underflows by computing divisions last
 //   - avoid divisions by 0 with +1 since all values in the diviser are
 //     guaranteed positives
-inline Vec2 norm(const Vec2& a, int norm)
+constexpr inline Vec2 norm(const Vec2& a, int norm)
 {
   int m = mag(a);
   return {(x(a) * norm) / (m + 1), (y(a) * norm) / (m + 1)};
@@ -270,7 +280,7 @@ constexpr inline bool within(const Box2& b, const Vec2& v) {
 // Given two positions at discreet time t0 and t1 and a distance of closest
 // appraoch `sqrad`, perform recursive halving of the time interval to check
 // whether the particle collided.
-inline int linear_collide(Vec2 x0, Vec2 y0, Vec2 x1, Vec2 y1, int sqrad) {
+constexpr inline int linear_collide(Vec2 x0, Vec2 y0, Vec2 x1, Vec2 y1, int sqrad) {
   constexpr const int stop_delta = 4;
   int sqd0 = distsq(x0, y0);
   if (sqd0 < sqrad) { return sqrad; }
@@ -291,6 +301,21 @@ inline int linear_collide(Vec2 x0, Vec2 y0, Vec2 x1, Vec2 y1, int sqrad) {
   return (sqd0 < sqd1) ? sqd0 : sqd1;
 }
 
+// Given a point moving in a straight line from `p0` to `p1` during a step,
+// returns whether it came within a distance (squared) `sqrad` of the static
+// point `c`, even when it went right through within the step. The closest
+// approach is found by projection on the segment, in 64 bits to avoid
+// overflows.
+constexpr inline bool swept_within(const Vec2& p0, const Vec2& p1, const Vec2& c, int sqrad) {
+  Vec2 d = p1 - p0;
+  Vec2 f = c - p0;
+  long long dot = (long long)x(f) * x(d) + (long long)y(f) * y(d);
+  if (dot <= 0) { return distsq(p0, c) < sqrad; }
+  long long len = magsq(d);
+  if (dot >= len) { return distsq(p1, c) < sqrad; }
+  return (long long)magsq(f) * len - dot * dot < (long long)sqrad * len;
+}
+
 // The basic polar coordinate information, with an angle in degree and a radius
 // equivalent to the distance to the pole. Radius is always positive. If it is
 // found to be negative, program behaviour will be undefined.
@@ -321,24 +346,24 @@ inline std::ostream& operator<< (std::ostream& o, const Ray2& a) {
 }
 
 // Angular norm: angle expressed between [-180, 180]
-inline int anorm(int a) {
+constexpr inline int anorm(int a) {
   a = a % 360;
   return isgv(180 - iabs(a), a, a - isgn(a, 360));
 }
 
-inline Ray2 norm(const Ray2& a) { return {anorm(angle(a)), rad(a)}; }
+constexpr inline Ray2 norm(const Ray2& a) { return {anorm(angle(a)), rad(a)}; }
 
-inline Vec2 vec(const Ray2& a) { return Vec2{ icos(angle(a), rad(a)), isin(angle(a), rad(a)) }; }
-inline Ray2 ray(const Vec2& a) {
+constexpr inline Vec2 vec(const Ray2& a) { return Vec2{ icos(angle(a), rad(a)), isin(angle(a), rad(a)) }; }
+constexpr inline Ray2 ray(const Vec2& a) {
   int r = mag(a);
   return (r == 0) ? Ray2{0, 0} : Ray2{iacos3(x(a), y(a), r), r};
 }
 
 // Angular difference is always expressed between [-180, 180]
-inline int adiff(int a, int b) { return anorm(a - b); }
+constexpr inline int adiff(int a, int b) { return anorm(a - b); }
 
 // Angular distance is always expressed between [0, 180]
-inline int adist(int a, int b) {
+constexpr inline int adist(int a, int b) {
   a = iabs(a - b) % 360;
   return isgv(180 - a, a, 360 - a);
 }
@@ -381,18 +406,192 @@ inline std::ostream& operator<<(std::ostream& o, const Particle& a) {
   return o;
 }
 
-inline Particle linear_motion(const Particle& p) {
+// PackedParticle is a compact particle for search nodes and trajectory
+// buffers: positions, speeds and orientation fit in 16 bits on the maps of the
+// puzzles, while the radius and the mass are constant for each type of unit,
+// given at compile time by `Traits::RADIUS` and `Traits::MASS`, such as:
+//
+//     struct PodTraits {
+//       static constexpr const int RADIUS = 400;
+//       static constexpr const float MASS = .5f;
+//     };
+//
+// The particle accessors work the same, except that `rad` and `mass` can't be
+// assigned and `pos` and `spd` return proxies when the particle is mutable,
+// whose coordinates are assigned with `x` and `y` as usual. Values outside of
+// 16 bits are clamped when packed. A PackedParticle converts to and from a
+// Particle, so it can be passed to `reaction` and the others.
+constexpr inline std::int16_t pack16(int v)
+{ return std::int16_t(imax(INT16_MIN, imin(v, INT16_MAX))); }
+
+struct PackedVec2 {
+  std::int16_t& x;
+  std::int16_t& y;
+  operator Vec2() const { return {x, y}; }
+  PackedVec2& operator= (const Vec2& v)
+  { x = pack16(v.x); y = pack16(v.y); return *this; }
+};
+
+inline std::int16_t& x(const PackedVec2& a) { return a.x; }
+inline std::int16_t& y(const PackedVec2& a) { return a.y; }
+
+template<typename Traits>
+struct PackedParticle {
+  PackedParticle() = default;
+  PackedParticle(const Particle& p)
+    : px(pack16(x(p.pos))), py(pack16(y(p.pos))),
+      vx(pack16(x(p.spd))), vy(pack16(y(p.spd))),
+      orient(pack16(p.orient)) { }
+  operator Particle() const
+  { return {{px, py}, {vx, vy}, orient, Traits::RADIUS, Traits::MASS}; }
+  std::int16_t px, py, vx, vy, orient;
+};
+
+template<typename Traits>
+constexpr inline Vec2 pos(const PackedParticle<Traits>& a) { return {a.px, a.py}; }
+template<typename Traits>
+inline PackedVec2 pos(PackedParticle<Traits>& a) { return {a.px, a.py}; }
+template<typename Traits>
+constexpr inline Vec2 spd(const PackedParticle<Traits>& a) { return {a.vx, a.vy}; }
+template<typename Traits>
+inline PackedVec2 spd(PackedParticle<Traits>& a) { return {a.vx, a.vy}; }
+template<typename Traits>
+constexpr inline int orient(const PackedParticle<Traits>& a) { return a.orient; }
+template<typename Traits>
+constexpr inline std::int16_t& orient(PackedParticle<Traits>& a) { return a.orient; }
+template<typename Traits>
+constexpr inline int rad(const PackedParticle<Traits>&) { return Traits::RADIUS; }
+template<typename Traits>
+constexpr inline float mass(const PackedParticle<Traits>&) { return Traits::MASS; }
+
+// ParticleBatch stores up to N particles as a structure of arrays, so that the
+// same step applied to all of them can use SIMD instructions, which the
+// Particle records don't allow. Vec2Batch holds a vector per particle, such as
+// the thrust. The batch versions of the models give the exact same results as
+// their scalar versions. GCC only vectorizes loops whose length isn't known
+// at compile time from -O3: the batch loops are marked with BATCH_LOOPS so
+// that it weighs them as it would at -O3, at -O2 as well.
+#if defined(__GNUC__) && !defined(__clang__)
+#define BATCH_LOOPS __attribute__((optimize("vect-cost-model=dynamic")))
+#else
+#define BATCH_LOOPS
+#endif
+
+template<unsigned N>
+struct Vec2Batch {
+  alignas(32) std::array<int, N> x, y;
+};
+
+// Ray2Batch holds a polar vector per particle, such as the output of Actions.
+template<unsigned N>
+struct Ray2Batch {
+  alignas(32) std::array<int, N> angle, rad;
+};
+
+template<unsigned N>
+struct ParticleBatch {
+  ParticleBatch() : size(0) { }
+
+  Particle get(unsigned i) const
+  { return {{px[i], py[i]}, {vx[i], vy[i]}, orient[i], rad[i], mass[i]}; }
+
+  void set(unsigned i, const Particle& p) {
+    px[i] = x(pos(p)); py[i] = y(pos(p));
+    vx[i] = x(spd(p)); vy[i] = y(spd(p));
+    orient[i] = ::orient(p); rad[i] = ::rad(p); mass[i] = ::mass(p);
+  }
+
+  template<typename Particles>
+  void load(const Particles& ps) {
+    size = ps.size();
+    for (unsigned i = 0; i < size; ++i) { set(i, ps[i]); }
+  }
+
+  template<typename Particles>
+  void store(Particles& ps) const {
+    for (unsigned i = 0; i < size; ++i) { ps[i] = get(i); }
+  }
+
+  unsigned size;
+  alignas(32) std::array<int, N> px, py, vx, vy, orient, rad;
+  alignas(32) std::array<float, N> mass;
+};
+
+// Integer division through doubles: it vectorizes where integer division
+// doesn't, and is exact as long as both operands are well within 2^52.
+constexpr inline int ddiv(int a, int b) { return int(double(a) / double(b)); }
+
+// Versions of `ihyp`, `isin`, `angle(ray())`, `anorm`, `adiff` and `adist`
+// for batch loops: without branches, and with integer divisions done by
+// `ddiv`. They return the same results.
+constexpr inline int dhyp(int adjacent, int opposite) {
+  int S = sq(adjacent) + sq(opposite);
+  int a = iabs(adjacent), o = iabs(opposite);
+  int x = a + o;
+  x = ddiv(sq(x) + S, 2 * x + 1);
+  x = ddiv(sq(x) + S, 2 * x + 1);
+  x = ddiv(sq(x) + S, 2 * x + 1);
+  return imax(imax(x, a), o);
+}
+
+constexpr inline int dsin(int angle, int scale) {
+  constexpr const int Factor = 81;
+  constexpr const int Factor2 = 54 * sq(Factor);
+  constexpr const float Factor3 = Factor2 * Factor;
+  constexpr const int bits = sizeof(int) * 8;
+  int s = angle >> (bits - 1);
+  int aa = ddiv(((angle^s) - s) * 128 + 45, 90);
+  int h = (aa << (bits - 9)) >> (bits - 1);
+  int q = -((aa >> 7) & 1);                      // second quadrant: 0 or -1
+  int ra = aa & 0x7F;
+  ra = ((ra^q) - q) + (q & 128);                 // 128 - ra in second quadrant
+  float f = float(ra * (Factor2 - (sq(ra) * 8))) / Factor3;
+  ra = scale * f;
+  s = h^s;
+  return (ra^s) - s;
+}
+
+constexpr inline int dcos(int angle, int scale) { return dsin(90 - angle, scale); }
+
+constexpr inline int dangle(int x, int y) {
+  int h = dhyp(x, y);
+  return namp(-h, iacos3(x, y, imax(h, 1)));   // 0 for the null vector
+}
+
+constexpr inline int danorm(int a) {
+  a = a - ddiv(a, 360) * 360;
+  return isgv(180 - iabs(a), a, a - isgn(a, 360));
+}
+
+constexpr inline int dadiff(int a, int b) { return danorm(a - b); }
+
+constexpr inline int dadist(int a, int b) {
+  a = iabs(a - b);
+  a = a - ddiv(a, 360) * 360;
+  return isgv(180 - a, a, 360 - a);
+}
+
+// Batch version of `vec`, for the first `size` rays.
+template<unsigned N>
+BATCH_LOOPS inline void vec(const Ray2Batch<N>& r, Vec2Batch<N>& v, unsigned size) {
+  for (unsigned i = 0; i < size; ++i) {
+    v.x[i] = dcos(r.angle[i], r.rad[i]);
+    v.y[i] = dsin(r.angle[i], r.rad[i]);
+  }
+}
+
+constexpr inline Particle linear_motion(const Particle& p) {
   return {spd(p) + pos(p), spd(p), orient(p), rad(p), mass(p)};
 }
 
-inline Particle reaction(const Particle& p, const Vec2& t) {
+constexpr inline Particle reaction(const Particle& p, const Vec2& t) {
   Vec2 a_ = t / mass(p);
   Vec2 p_ = a_ / 2 + spd(p) + pos(p);
   Vec2 s_ = a_+ spd(p);
   return {p_, s_, orient(p), rad(p), mass(p)};
 }
 
-inline Particle reaction(const Particle& p, const Vec2& t, int iterations) {
+constexpr inline Particle reaction(const Particle& p, const Vec2& t, int iterations) {
   Vec2 a_ = t / mass(p);
   Vec2 p_ = (a_ * sq(iterations)) / 2 + spd(p) * iterations + pos(p);
   Vec2 s_ = a_ * iterations + spd(p);
@@ -407,11 +606,34 @@ inline Particle reaction(const Particle& p, const Vec2& t, int iterations) {
 // realistic, but seem to occur in the puzzles. Mass is ignored in this model.
 struct InstantThrustModel
 {
-  Particle operator() (const Particle& p, const Vec2& t) const {
+  constexpr Particle operator() (const Particle& p, const Vec2& t) const {
     Vec2 s_ = t + spd(p);
     Vec2 p_ = s_ + pos(p);
     return {p_, s_, orient(p), rad(p), mass(p)};
   }
+
+  // The thrust `t`, or the push `r`, with the drag `f`.
+  constexpr Particle operator() (const Particle& p, const Vec2& t, const Vec2& f) const {
+    return (*this)(p, t + f);
+  }
+  constexpr Particle operator() (const Particle& p, const Ray2& r, const Vec2& f) const {
+    return (*this)(p, vec(r) + f);
+  }
+
+  // The same force applied for several turns.
+  constexpr Particle operator() (const Particle& p, const Vec2& t, int iterations) const {
+    Vec2 s_ = t * iterations + spd(p);
+    Vec2 p_ = (t * (iterations * (iterations + 1))) / 2 + spd(p) * iterations + pos(p);
+    return {p_, s_, orient(p), rad(p), mass(p)};
+  }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (ParticleBatch<N>& b, const Vec2Batch<N>& t) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      b.vx[i] += t.x[i]; b.vy[i] += t.y[i];
+      b.px[i] += b.vx[i]; b.py[i] += b.vy[i];
+    }
+  }
 };
 
 // RealisticThrustModel applies the force as if it had pushed the particle
@@ -419,9 +641,53 @@ struct InstantThrustModel
 // instant. This model is closer to reality, hence the name.
 struct RealisticThrustModel
 {
-  Particle operator() (const Particle& p, const Vec2& t) const {
+  constexpr Particle operator() (const Particle& p, const Vec2& t) const {
     return reaction(p, t);
   }
+
+  constexpr Particle operator() (const Particle& p, const Vec2& t, const Vec2& f) const {
+    return reaction(p, t + f);
+  }
+  constexpr Particle operator() (const Particle& p, const Ray2& r, const Vec2& f) const {
+    return reaction(p, vec(r) + f);
+  }
+
+  constexpr Particle operator() (const Particle& p, const Vec2& t, int iterations) const {
+    return reaction(p, t, iterations);
+  }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (ParticleBatch<N>& b, const Vec2Batch<N>& t) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      int ax = int(float(t.x[i]) / b.mass[i]), ay = int(float(t.y[i]) / b.mass[i]);
+      b.px[i] += ax / 2 + b.vx[i]; b.py[i] += ay / 2 + b.vy[i];
+      b.vx[i] += ax; b.vy[i] += ay;
+    }
+  }
+};
+
+// RotationLimitedThrustModel wraps another ThrustModel for particles that can
+// only turn by MAX_ROTATION degree per turn, such as pods in racing puzzles:
+// the particle first rotates toward the heading of the push, within that
+// limit, and the thrust is then applied along its new orientation, with the
+// drag `f`. A push without thrust still rotates the particle, so that it can
+// turn in place. A thrust vector carries no heading when it's zero: the
+// orientation is kept then.
+template<typename ThrustModel, int MAX_ROTATION>
+struct RotationLimitedThrustModel : private ThrustModel
+{
+  constexpr RotationLimitedThrustModel(const ThrustModel& tm = ThrustModel()) : ThrustModel(tm) { }
+
+  constexpr Particle operator() (const Particle& p, const Ray2& r, const Vec2& f) const {
+    int d = adiff(angle(r), orient(p));
+    Particle p_ = p;
+    orient(p_) = anorm(orient(p) + isgn(d, imin(iabs(d), MAX_ROTATION)));
+    return ThrustModel::operator()(p_, vec({orient(p_), rad(r)}) + f);
+  }
+
+  constexpr Particle operator() (const Particle& p, const Vec2& t, const Vec2& f) const {
+    return (t == Vec2{0, 0}) ? ThrustModel::operator()(p, f) : (*this)(p, ray(t), f);
+  }
 };
 
 // Dragmodels functors return the force of drag execrted on a particle in a
@@ -431,7 +697,12 @@ struct RealisticThrustModel
 // for the drag. Good for testing.
 struct VaccumDragModel
 {
-  Vec2 operator() (const Particle&) const { return {0, 0}; }
+  constexpr Vec2 operator() (const Particle&) const { return {0, 0}; }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Vec2Batch<N>& d) const {
+    for (unsigned i = 0; i < b.size; ++i) { d.x[i] = 0; d.y[i] = 0; }
+  }
 };
 
 // This simple model seem to be present in several puzzles. For a given type of
@@ -441,8 +712,97 @@ struct VaccumDragModel
 template<int MAX_THRUST, int MAX_VELOCITY>
 struct BasicDragModel
 {
-  Vec2 operator() (const Particle& p) const {
-    return norm(-spd(p), (mag(spd(p)) * MAX_THRUST) / MAX_VELOCITY);
+  // Same as `norm(-spd(p), (mag(spd(p)) * MAX_THRUST) / MAX_VELOCITY)`, with
+  // the magnitude computed once instead of twice.
+  constexpr Vec2 operator() (const Particle& p) const {
+    int m = mag(spd(p));
+    int n = (m * MAX_THRUST) / MAX_VELOCITY;
+    return {(-x(spd(p)) * n) / (m + 1), (-y(spd(p)) * n) / (m + 1)};
+  }
+
+  // Same as above, with `norm` unrolled, without branches.
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Vec2Batch<N>& d) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      int sx = b.vx[i], sy = b.vy[i];
+      int m = dhyp(sx, sy);
+      int n = ddiv(m * MAX_THRUST, MAX_VELOCITY);
+      d.x[i] = ddiv(-sx * n, m + 1);
+      d.y[i] = ddiv(-sy * n, m + 1);
+    }
+  }
+};
+
+// TabulatedDragModel gives the same results as BasicDragModel, but looks the
+// drag magnitude up in a table built at compile time, for speeds below `SIZE`,
+// saving a division per evaluation. Faster speeds are computed.
+template<int MAX_THRUST, int MAX_VELOCITY, int SIZE = 2 * MAX_VELOCITY>
+struct TabulatedDragModel : BasicDragModel<MAX_THRUST, MAX_VELOCITY>
+{
+  using BasicDragModel<MAX_THRUST, MAX_VELOCITY>::operator();
+
+  constexpr Vec2 operator() (const Particle& p) const {
+    int m = mag(spd(p));
+    int n = (m < SIZE) ? _table.n[m] : (m * MAX_THRUST) / MAX_VELOCITY;
+    return {(-x(spd(p)) * n) / (m + 1), (-y(spd(p)) * n) / (m + 1)};
+  }
+
+private:
+  struct _Table {
+    constexpr _Table() : n() {
+      for (int m = 0; m < SIZE; ++m) { n[m] = (m * MAX_THRUST) / MAX_VELOCITY; }
+    }
+    int n[SIZE];
+  };
+  static constexpr const _Table _table = _Table();
+};
+
+template<int MAX_THRUST, int MAX_VELOCITY, int SIZE>
+constexpr const typename TabulatedDragModel<MAX_THRUST, MAX_VELOCITY, SIZE>::_Table
+TabulatedDragModel<MAX_THRUST, MAX_VELOCITY, SIZE>::_table;
+
+// CollisionModels functors return the speeds of 2 particles after they have
+// come in contact with each other, given their present characteristics and
+// whether either of them is shielded.
+//
+// NoCollisionModel lets particles go through each other, as if they were
+// ghosts. This is the default, and the way all the puzzles were played so far.
+struct NoCollisionModel
+{
+  std::tuple<Particle, Particle>
+  operator() (const Particle& a, const Particle& b, bool = false, bool = false) const
+  { return std::make_tuple(a, b); }
+};
+
+// ElasticCollisionModel is the model of the referee in several racing puzzles:
+// a perfectly elastic bounce, where the impulse is applied in 2 halves and the
+// second half is never less than `MIN_IMPULSE`, so that particles always
+// separate. A shielded particle has its mass multiplied by `SHIELD_FACTOR`.
+//
+// `MIN_IMPULSE` is expressed in the same mass unit as the particles: with pods
+// of mass 1 the referee uses 120, with pods of mass .5 that should be 60.
+template<int MIN_IMPULSE, int SHIELD_FACTOR>
+struct ElasticCollisionModel
+{
+  std::tuple<Particle, Particle>
+  operator() (const Particle& a, const Particle& b,
+              bool shield_a = false, bool shield_b = false) const {
+    float ma = shield_a ? mass(a) * SHIELD_FACTOR : mass(a);
+    float mb = shield_b ? mass(b) * SHIELD_FACTOR : mass(b);
+    Vec2 n = pos(a) - pos(b);
+    float nsq = float(magsq(n));
+    if (nsq == 0.f) { return std::make_tuple(a, b); } // no normal, no bounce
+    float product = float(x(n)) * float(x(spd(a)) - x(spd(b)))
+      + float(y(n)) * float(y(spd(a)) - y(spd(b)));
+    float k = product / (nsq * (ma + mb) / (ma * mb)); // half impulse / |n|
+    float fx = x(n) * k, fy = y(n) * k;
+    float impulse = std::sqrt(fx * fx + fy * fy);
+    float ratio = (impulse < MIN_IMPULSE && impulse > 0.f)
+      ? 1.f + float(MIN_IMPULSE) / impulse : 2.f;    // both halves
+    Particle a_ = a, b_ = b;
+    spd(a_) = {int(x(spd(a)) - fx * ratio / ma), int(y(spd(a)) - fy * ratio / ma)};
+    spd(b_) = {int(x(spd(b)) + fx * ratio / mb), int(y(spd(b)) + fy * ratio / mb)};
+    return std::make_tuple(a_, b_);
   }
 };
 
@@ -450,15 +810,25 @@ struct BasicDragModel
 // break distance under drag in any phyical model.
 struct CoastingAction
 {
-  Ray2 operator() (const Particle& p) const { return {orient(p), 0}; }
+  constexpr Ray2 operator() (const Particle& p) const { return {orient(p), 0}; }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    for (unsigned i = 0; i < b.size; ++i) { r.angle[i] = b.orient[i]; r.rad[i] = 0; }
+  }
 };
 
 // ConstantAction just makes the particle accelerate with a constant thrust
 // applied in the same direction. Good for tests.
 struct ConstantAction
 {
-  ConstantAction(const Vec2& thrust) : _thrust(ray(thrust)) { }
-  Ray2 operator() (const Particle&) const { return _thrust; }
+  constexpr ConstantAction(const Vec2& thrust) : _thrust(ray(thrust)) { }
+  constexpr Ray2 operator() (const Particle&) const { return _thrust; }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    for (unsigned i = 0; i < b.size; ++i) { r.angle[i] = angle(_thrust); r.rad[i] = rad(_thrust); }
+  }
 private:
   Ray2 _thrust;
 };
@@ -468,11 +838,19 @@ private:
 // target is set in the constructor.
 struct TargetAction
 {
-  TargetAction(const Vec2& target, int thrust)
+  constexpr TargetAction(const Vec2& target, int thrust)
     : _target(target), _thrust(thrust) { }
-  Ray2 operator() (const Particle& p) const {
+  constexpr Ray2 operator() (const Particle& p) const {
     return {angle(ray(_target - pos(p))), _thrust};
   }
+
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    for (unsigned i = 0; i < b.size; ++i) {
+      r.angle[i] = dangle(x(_target) - b.px[i], y(_target) - b.py[i]);
+      r.rad[i] = _thrust;
+    }
+  }
 private:
   Vec2 _target;
   int _thrust;
@@ -484,8 +862,8 @@ private:
 template<int MAX_THRUST, int MAX_CORRECTION> // maximum correction angle
 struct AdvTargetAction
 {
-  AdvTargetAction(const Vec2& target, int radius) : _target(target), _radius(radius) { }
-  Ray2 operator() (const Particle& p) const {
+  constexpr AdvTargetAction(const Vec2& target, int radius) : _target(target), _radius(radius) { }
+  constexpr Ray2 operator() (const Particle& p) const {
     constexpr const int FULL_COMP_ANGLE = 90;  // angle of full acceleration
     constexpr const int INIT_COMP_ANGLE = 100; // angle of initial acceleration
     if (magsq(spd(p)) < 100)                   // at low speed, straight to target
@@ -507,44 +885,559 @@ struct AdvTargetAction
     else { rad(push) = ((ori_d - (FULL_COMP_ANGLE - abs_d)) * MAX_THRUST) / (INIT_COMP_ANGLE - FULL_COMP_ANGLE); }
     return push;
   }
+
+  // Same as above, for all particles of a batch: every branch is computed and
+  // the result is selected by masks, so that the loop can be vectorized.
+  template<unsigned N>
+  BATCH_LOOPS void operator() (const ParticleBatch<N>& b, Ray2Batch<N>& r) const {
+    constexpr const int FULL_COMP_ANGLE = 90;
+    constexpr const int INIT_COMP_ANGLE = 100;
+    const unsigned size = b.size;             // may alias with r otherwise
+    for (unsigned i = 0; i < size; ++i) {
+      int vx = b.vx[i], vy = b.vy[i];
+      int dx = x(_target) - b.px[i], dy = y(_target) - b.py[i];
+      int dir = dangle(dx, dy);
+      int pro = dangle(vx, vy);
+      int slow = sq(vx) + sq(vy) < 100;
+      int arriving = (sq(vx - dx) + sq(vy - dy) < sq(_radius))
+        & (dadist(pro, b.orient[i]) < MAX_CORRECTION);
+      int pro_d = dadiff(dir, pro);
+      int push = dir + amp(FULL_COMP_ANGLE - 1 - iabs(pro_d),
+                           isgn(pro_d, imin(iabs(pro_d), MAX_CORRECTION)));
+      int abs_d = dadist(dir, dangle(dx - vx, dy - vy));
+      int ori_d = dadist(push, b.orient[i]);
+      int thrust = ddiv((ori_d - (FULL_COMP_ANGLE - abs_d)) * MAX_THRUST,
+                        INIT_COMP_ANGLE - FULL_COMP_ANGLE);
+      thrust = isgv(ori_d - (FULL_COMP_ANGLE - abs_d), thrust, MAX_THRUST);
+      thrust = isgv(INIT_COMP_ANGLE - abs_d - ori_d, thrust, 0);
+      r.angle[i] = isgv(-slow, isgv(-arriving, push, pro), dir);
+      r.rad[i] = isgv(-(slow | arriving), thrust, MAX_THRUST);
+    }
+  }
 private:
   Vec2 _target;
   int _radius;
 };
 
-// Physics are modeled with a ThrustModel and a DragModel.
-template<typename ThrustModel, typename DragModel>
-struct Physics : private ThrustModel, DragModel {
-  Physics(const ThrustModel& tm = ThrustModel(),
-          const DragModel& dm = DragModel())
-    : ThrustModel(tm), DragModel(dm) { }
-  const ThrustModel& thrustModel() const { return *this; }
-  const DragModel& dragModel() const { return *this; }
+// Physics are modeled with a ThrustModel, a DragModel and a CollisionModel.
+// Without CollisionModel, particles go through each other.
+template<typename ThrustModel, typename DragModel,
+         typename CollisionModel = NoCollisionModel>
+struct Physics : private ThrustModel, DragModel, CollisionModel {
+  constexpr Physics(const ThrustModel& tm = ThrustModel(),
+                    const DragModel& dm = DragModel(),
+                    const CollisionModel& cm = CollisionModel())
+    : ThrustModel(tm), DragModel(dm), CollisionModel(cm) { }
+  constexpr const ThrustModel& thrustModel() const { return *this; }
+  constexpr const DragModel& dragModel() const { return *this; }
+  constexpr const CollisionModel& collisionModel() const { return *this; }
 };
 
 // `reaction`, `iterate_reaction` and `until_reaction` project actions on
 // particles to compute the future of a particle based on its
 // known present and a phyical model.
-template<typename ThrustModel, typename DragModel>
-inline Particle reaction(const Particle& p, const Vec2& t,
-                         const Physics<ThrustModel, DragModel>& phy) {
-  return phy.thrustModel()(p, t + phy.dragModel()(p));
+//
+// Like the Actions and the models, they are constexpr, so that tables of
+// trajectories, such as braking distances, can be computed by the compiler and
+// cost nothing at run time.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+constexpr inline Particle reaction(const Particle& p, const Vec2& t,
+                                   const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  return phy.thrustModel()(p, t, phy.dragModel()(p));
+}
+
+// Same as above for the push `r` of an Action, which keeps its heading even
+// without thrust. It's a template only so that braced thrusts, such as
+// `reaction(p, {0, 100}, phy)`, still go to the Vec2 version.
+template<typename Push, typename ThrustModel, typename DragModel, typename CollisionModel,
+         typename = typename std::enable_if<std::is_same<Push, Ray2>::value>::type>
+constexpr inline Particle reaction(const Particle& p, const Push& r,
+                                   const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  return phy.thrustModel()(p, r, phy.dragModel()(p));
 }
 
-template<typename Action, typename ThrustModel, typename DragModel>
-inline Particle iterate_reaction(unsigned times, Particle p, const Action& a,
-                                 const Physics<ThrustModel, DragModel>& phy) {
-  for (unsigned i = 0; i < times; ++i) { p = reaction(p, vec(a(p)), phy); }
+// Multi-turn version of `reaction`: the thrust and the drag at present are
+// applied unchanged for several turns. ThrustModels that steer are not
+// supported.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+constexpr inline Particle reaction(const Particle& p, const Vec2& t, int iterations,
+                                   const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  return phy.thrustModel()(p, t + phy.dragModel()(p), iterations);
+}
+
+// Batch version of `reaction`, applying the thrusts `t` to all particles in
+// place. ThrustModels that steer are not supported.
+template<unsigned N, typename ThrustModel, typename DragModel, typename CollisionModel>
+BATCH_LOOPS inline void reaction(ParticleBatch<N>& b, const Vec2Batch<N>& t,
+                     const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  Vec2Batch<N> f;
+  phy.dragModel()(b, f);
+  for (unsigned i = 0; i < b.size; ++i) { f.x[i] += t.x[i]; f.y[i] += t.y[i]; }
+  phy.thrustModel()(b, f);
+}
+
+template<typename Action, typename ThrustModel, typename DragModel, typename CollisionModel>
+constexpr inline Particle iterate_reaction(unsigned times, Particle p, const Action& a,
+                                           const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  for (unsigned i = 0; i < times; ++i) { p = reaction(p, a(p), phy); }
   return p;
 }
 
-template<typename Action, typename ThrustModel, typename DragModel, typename Predicate>
-inline Particle until_reaction(Particle p, const Action& a, const Predicate& t,
-                               const Physics<ThrustModel, DragModel>& phy) {
-  while (!t(p)) { p = reaction(p, vec(a(p)), phy); }
+// Batch version of `iterate_reaction`, for Actions that have a batch version.
+template<unsigned N, typename Action,
+         typename ThrustModel, typename DragModel, typename CollisionModel>
+inline void iterate_reaction(unsigned times, ParticleBatch<N>& b, const Action& a,
+                             const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  Ray2Batch<N> r;
+  Vec2Batch<N> t;
+  for (unsigned i = 0; i < times; ++i) {
+    a(b, r);
+    vec(r, t, b.size);
+    reaction(b, t, phy);
+  }
+}
+
+template<typename Action, typename ThrustModel, typename DragModel, typename CollisionModel,
+         typename Predicate>
+constexpr inline Particle until_reaction(Particle p, const Action& a, const Predicate& t,
+                                         const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  while (!t(p)) { p = reaction(p, a(p), phy); }
   return p;
 }
 
+// `adaptive_reaction` is `iterate_reaction` for far horizons: while `near(p)`
+// is false, i.e. the particle is far from any checkpoint or other particle, it
+// takes coarse steps of up to `max_step` turns with the multi-turn `reaction`.
+// Each coarse step is checked against 2 steps of half its length, and halved
+// until both agree within `tolerance` units. Near interactions, it takes
+// single steps. `near` should have a margin of a few turns of motion.
+//
+// `tolerance` is per step, and relative to the half steps: it is not a bound
+// on the drift from `iterate_reaction` over the whole horizon. The errors of
+// successive steps add up, and errors on the speed keep growing the error on
+// the position over the following turns. With `max_step` 2, the half steps
+// are single steps, and the result is the same as `iterate_reaction`.
+template<typename Action, typename Predicate,
+         typename ThrustModel, typename DragModel, typename CollisionModel>
+inline Particle adaptive_reaction(unsigned times, Particle p, const Action& a,
+                                  const Predicate& near,
+                                  const Physics<ThrustModel, DragModel, CollisionModel>& phy,
+                                  int tolerance = 16, unsigned max_step = 8) {
+  unsigned k = max_step;
+  while (times > 0) {
+    if (k > times) { k = times; }
+    bool far = !near(p);
+    Particle h = p;
+    for (; far && k > 1; k /= 2) {
+      Particle c = reaction(p, vec(a(p)), k, phy);
+      h = reaction(p, vec(a(p)), k / 2, phy);
+      h = reaction(h, vec(a(h)), k - k / 2, phy);
+      if (distsq(pos(c), pos(h)) <= sq(tolerance) && !near(h)) { break; }
+    }
+    if (far && k > 1) {
+      p = h;
+      times -= k;
+      k = (2 * k < max_step) ? 2 * k : max_step;
+    }
+    else {
+      p = reaction(p, a(p), phy);
+      --times;
+      k = 2;
+    }
+  }
+  return p;
+}
+
+// TimeToReach answers many "how many turns until the particle comes within
+// `radius` of the target" queries, with the Action returned by `make(target)`,
+// such as an AdvTargetAction. Answers are capped to `max_turns`.
+//
+//   - a particle moving at most `vmax` per turn needs at least
+//     (distance - radius) / vmax turns: queries that can't make it within
+//     `max_turns` are answered without simulation, and `first` examines
+//     queries by increasing lower bound and stops when none can beat the best,
+//   - the rest is simulated turn by turn, with swept checks so that fast
+//     particles going through the target are caught,
+//   - answers are memoized for the relative position, speed and orientation,
+//     quantized, in a table of CACHE entries. Actions must only depend on
+//     those. Call `clear` each turn to forget them, in O(1).
+//
+// The physics is copied, so it can be built from a temporary.
+template<unsigned CACHE, typename Physics, typename Factory>
+struct TimeToReach {
+  static constexpr const int POS_QUANTUM = 64;
+  static constexpr const int SPD_QUANTUM = 16;
+  static constexpr const int ORIENT_QUANTUM = 4;
+
+  TimeToReach(const Physics& phy, const Factory& make, int radius, int vmax, int max_turns)
+    : hits(0), misses(0), _phy(phy), _make(make), _radius(radius), _vmax(vmax),
+      _max_turns(max_turns), _generation(1) { _cache.fill(_Entry{0, 0, 0}); }
+
+  void clear() { ++_generation; }
+
+  int lower_bound(const Particle& p, const Vec2& target) const {
+    int d = mag(target - pos(p));
+    int gap = d - d / 64 - _radius;
+    return (gap <= 0) ? 0 : (gap + _vmax - 1) / _vmax;
+  }
+
+  int operator() (const Particle& p, const Vec2& target) {
+    return _solve(p, target, _max_turns);
+  }
+
+  // Answers all the queries `(ps[i], targets[i])` in `out[i]`.
+  template<typename Particles, typename Targets, typename Out>
+  void operator() (const Particles& ps, const Targets& targets, Out& out) {
+    for (unsigned i = 0; i < ps.size(); ++i) { out[i] = _solve(ps[i], targets[i], _max_turns); }
+  }
+
+  // Returns the index of the query that reaches its target first, and the
+  // number of turns it needs. Up to N queries: the others are left out.
+  template<unsigned N, typename Particles, typename Targets>
+  std::pair<unsigned, int> first(const Particles& ps, const Targets& targets) {
+    unsigned n = (ps.size() < N) ? unsigned(ps.size()) : N;
+    std::array<std::pair<int, unsigned>, N> order;
+    for (unsigned i = 0; i < n; ++i) { order[i] = std::make_pair(lower_bound(ps[i], targets[i]), i); }
+    std::sort(order.begin(), order.begin() + n);
+    std::pair<unsigned, int> best(n, _max_turns);
+    for (unsigned i = 0; i < n && order[i].first < best.second; ++i) {
+      unsigned k = order[i].second;
+      int t = _solve(ps[k], targets[k], best.second);
+      if (t < best.second || best.first == n) { best = std::make_pair(k, t); }
+    }
+    return best;
+  }
+
+  unsigned hits, misses;
+
+private:
+  struct _Entry { std::uint64_t key; unsigned generation; int turns; };
+
+  // Rounded down, so that all the buckets have the same width, including
+  // the ones around 0.
+  static constexpr int _quantize(int v, int q) { return ((v < 0) ? v - q + 1 : v) / q; }
+
+  static std::uint64_t _key(const Particle& p, const Vec2& target) {
+    Vec2 d = target - pos(p);
+    std::uint64_t k = std::uint64_t(_quantize(x(d), POS_QUANTUM) & 0xfff);
+    k = (k << 12) | std::uint64_t(_quantize(y(d), POS_QUANTUM) & 0xfff);
+    k = (k << 9) | std::uint64_t(_quantize(x(spd(p)), SPD_QUANTUM) & 0x1ff);
+    k = (k << 9) | std::uint64_t(_quantize(y(spd(p)), SPD_QUANTUM) & 0x1ff);
+    k = (k << 9) | std::uint64_t(_quantize(anorm(orient(p)), ORIENT_QUANTUM) & 0x1ff);
+    return k;
+  }
+
+  int _solve(Particle p, const Vec2& target, int limit) {
+    if (lower_bound(p, target) >= limit) { return limit; }
+    std::uint64_t key = _key(p, target);
+    _Entry& e = _cache[(key ^ (key >> 29)) % CACHE];
+    if (e.generation == _generation && e.key == key) { ++hits; return imin(e.turns, limit); }
+    ++misses;
+    auto a = _make(target);
+    int sqrad = sq(_radius);
+    int t = 0;
+    if (distsq(pos(p), target) >= sqrad) {
+      for (t = 1; t <= _max_turns; ++t) {
+        Particle p_ = reaction(p, a(p), _phy);
+        if (swept_within(pos(p), pos(p_), target, sqrad)) { break; }
+        p = p_;
+      }
+      if (t > _max_turns) { t = _max_turns; }
+    }
+    e = _Entry{key, _generation, t};
+    return imin(t, limit);
+  }
+
+  Physics _phy;
+  Factory _make;
+  int _radius, _vmax, _max_turns;
+  unsigned _generation;
+  std::array<_Entry, CACHE> _cache;
+};
+
+template<unsigned CACHE, typename Physics, typename Factory>
+inline TimeToReach<CACHE, Physics, Factory>
+time_to_reach(const Physics& phy, const Factory& make, int radius, int vmax, int max_turns)
+{ return TimeToReach<CACHE, Physics, Factory>(phy, make, radius, vmax, max_turns); }
+
+// `bounce` returns both particles with their speeds after contact, according
+// to the physical model. Particles are expected to be in contact already, as
+// reported by `linear_collide` or `collide_two`.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline std::tuple<Particle, Particle>
+bounce(const Particle& a, const Particle& b,
+       const Physics<ThrustModel, DragModel, CollisionModel>& phy,
+       bool shield_a = false, bool shield_b = false) {
+  return phy.collisionModel()(a, b, shield_a, shield_b);
+}
+
+// CsbPhysics reproduces the referee of Coders Strike Back bit for bit, on the
+// integer state it gives us each turn. It doesn't fit the ThrustModel and
+// DragModel policies since the referee works with doubles during a turn:
+//
+//   - each pod rotates toward its target by at most MAX_ROTATION degree,
+//     except on the first turn where it faces the target straight away,
+//   - the thrust is applied in the exact direction of the pod,
+//   - pods move, bouncing on each other in the order of their collisions, with
+//     the referee's minimum impulse and the mass of shielded pods,
+//   - positions are rounded, speeds are slowed down by FRICTION and truncated,
+//     orientations are rounded.
+//
+// Orientations are in degree within [0, 360), like the referee's.
+struct CsbCommand { Vec2 target; int thrust; bool shield; };
+
+struct CsbPhysics {
+  static constexpr const double MAX_ROTATION = 18.;
+  static constexpr const double FRICTION = .85;
+  static constexpr const double MIN_IMPULSE = 120.;
+  static constexpr const double SHIELD_MASS = 10.;
+  static constexpr const int MAX_COLLISIONS = 64;
+
+  // Orientation of the pod after it rotated toward `target`.
+  static double heading(const Particle& p, const Vec2& target, bool first = false) {
+    double dx = x(target) - x(pos(p)), dy = y(target) - y(pos(p));
+    double d = std::sqrt(dx * dx + dy * dy);
+    if (d == 0.) { return orient(p); }
+    double a = std::acos(dx / d) * 180. / M_PI;
+    if (dy < 0.) { a = 360. - a; }
+    if (first) { return a; }
+    double o = orient(p);
+    double right = (o <= a) ? a - o : 360. - o + a;
+    double left = (o >= a) ? o - a : o + 360. - a;
+    double r = (right < left) ? right : -left;
+    if (r > MAX_ROTATION) { r = MAX_ROTATION; }
+    else if (r < -MAX_ROTATION) { r = -MAX_ROTATION; }
+    o += r;
+    if (o >= 360.) { o -= 360.; }
+    else if (o < 0.) { o += 360.; }
+    return o;
+  }
+
+  // Plays a full turn for all the pods.
+  template<std::size_t N>
+  void operator() (std::array<Particle, N>& pods, const std::array<CsbCommand, N>& cmds,
+                   bool first = false) const {
+    std::array<_Pod, N> ps = _thrust(pods, cmds, first);
+    std::array<bool, N * N> near;
+    near.fill(true);
+    _move(ps, near, 0.);
+    _land(pods, ps);
+  }
+
+  // Same as above, but only the pairs of pods that `schedule`, a
+  // ContactSchedule<N> given all the turns of these pods in order, reports
+  // as possibly in contact are tested for collisions. When a bounce throws a
+  // pod faster than the schedule's bound, all the pairs are tested for the
+  // rest of the turn, and the pod's pairs again at the next one.
+  template<std::size_t N, typename Schedule>
+  void operator() (std::array<Particle, N>& pods, const std::array<CsbCommand, N>& cmds,
+                   Schedule& schedule, bool first = false) const {
+    std::array<_Pod, N> ps = _thrust(pods, cmds, first);
+    // Speeds are rounded away from 0, so that the bound holds for the pods
+    std::array<Particle, N> bound;
+    for (std::size_t i = 0; i < N; ++i) {
+      const _Pod& p = ps[i];
+      bound[i] = {pos(pods[i]), {int(p.vx < 0. ? std::floor(p.vx) : std::ceil(p.vx)),
+                                 int(p.vy < 0. ? std::floor(p.vy) : std::ceil(p.vy))},
+                  0, rad(pods[i]), 1};
+    }
+    std::array<bool, N * N> near;
+    near.fill(false);
+    schedule(bound, [&near](unsigned i, unsigned j) { near[i * N + j] = true; });
+    std::array<bool, N> thrown = _move(ps, near, double(schedule.vmax()));
+    for (std::size_t i = 0; i < N; ++i) { if (thrown[i]) { schedule.wake(unsigned(i)); } }
+    _land(pods, ps);
+  }
+
+  // Plays a turn for a single pod.
+  Particle operator() (const Particle& p, const CsbCommand& cmd, bool first = false) const {
+    std::array<Particle, 1> pods = {{p}};
+    (*this)(pods, std::array<CsbCommand, 1>{{cmd}}, first);
+    return pods[0];
+  }
+
+private:
+  struct _Pod { double x, y, vx, vy, a, r, m; };
+
+  // Pods after their rotation and thrust.
+  template<std::size_t N>
+  static std::array<_Pod, N> _thrust(const std::array<Particle, N>& pods,
+                                     const std::array<CsbCommand, N>& cmds, bool first) {
+    std::array<_Pod, N> ps;
+    for (std::size_t i = 0; i < N; ++i) {
+      const Particle& p = pods[i];
+      double a = heading(p, cmds[i].target, first);
+      double t = cmds[i].shield ? 0. : double(cmds[i].thrust);
+      double ra = a * M_PI / 180.;
+      ps[i] = {double(x(pos(p))), double(y(pos(p))),
+               x(spd(p)) + std::cos(ra) * t, y(spd(p)) + std::sin(ra) * t,
+               a, double(rad(p)), cmds[i].shield ? SHIELD_MASS : 1.};
+    }
+    return ps;
+  }
+
+  // Moves the pods through the turn, bouncing the `near` pairs in the order
+  // of their collisions. With `vmax`, returns the pods that bounces threw
+  // faster than it, once all the pairs are near.
+  template<std::size_t N>
+  static std::array<bool, N> _move(std::array<_Pod, N>& ps, std::array<bool, N * N>& near,
+                                   double vmax) {
+    std::array<bool, N> thrown;
+    thrown.fill(false);
+    double t = 0.;
+    std::size_t li = N, lj = N;           // last collision, not to repeat it
+    for (int k = 0; t < 1.; ++k) {
+      std::size_t ci = N, cj = N;
+      double ct = 1. - t;
+      for (std::size_t i = 0; i < N; ++i) {
+        for (std::size_t j = i + 1; j < N; ++j) {
+          if (k >= MAX_COLLISIONS) { break; } // stuck pods: let them go
+          if (!near[i * N + j]) { continue; }
+          double c = _collision(ps[i], ps[j]);
+          if (c < 0. || (c == 0. && i == li && j == lj)) { continue; }
+          if (c + t < 1. && c < ct) { ct = c; ci = i; cj = j; }
+        }
+      }
+      for (_Pod& p : ps) { p.x += p.vx * ct; p.y += p.vy * ct; }
+      if (ci != N) {
+        _bounce(ps[ci], ps[cj]);
+        for (std::size_t i : {ci, cj}) {
+          if (vmax > 0. && ps[i].vx * ps[i].vx + ps[i].vy * ps[i].vy > vmax * vmax)
+            { thrown[i] = true; near.fill(true); }
+        }
+      }
+      li = ci; lj = cj;
+      t += ct;
+    }
+    return thrown;
+  }
+
+  // Rounds the pods at the end of the turn, and slows them down.
+  template<std::size_t N>
+  static void _land(std::array<Particle, N>& pods, const std::array<_Pod, N>& ps) {
+    for (std::size_t i = 0; i < N; ++i) {
+      const _Pod& p = ps[i];
+      pos(pods[i]) = {int(std::floor(p.x + .5)), int(std::floor(p.y + .5))};
+      spd(pods[i]) = {int(p.vx * FRICTION), int(p.vy * FRICTION)};
+      int o = int(std::floor(p.a + .5));
+      orient(pods[i]) = (o >= 360) ? o - 360 : o;
+    }
+  }
+
+  // Time of the first contact between 2 pods during the rest of the turn, or
+  // a negative value if they don't meet.
+  static double _collision(const _Pod& a, const _Pod& b) {
+    double x = a.x - b.x, y = a.y - b.y;
+    double sr = (a.r + b.r) * (a.r + b.r);
+    if (x * x + y * y < sr) { return 0.; }
+    double vx = a.vx - b.vx, vy = a.vy - b.vy;
+    if (vx == 0. && vy == 0.) { return -1.; }
+    // closest point to the origin on the relative motion line
+    double da = vy, db = -vx;
+    double c1 = da * x + db * y;
+    double det = da * da + db * db;
+    double cx = da * c1 / det, cy = db * c1 / det;
+    double pdist = cx * cx + cy * cy;
+    double mypdist = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+    if (pdist >= sr) { return -1.; }
+    double length = std::sqrt(vx * vx + vy * vy);
+    double backdist = std::sqrt(sr - pdist);
+    cx -= backdist * (vx / length);
+    cy -= backdist * (vy / length);
+    double d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+    if (d2 > mypdist) { return -1.; }
+    double d = std::sqrt(d2);
+    if (d > length) { return -1.; }
+    return d / length;
+  }
+
+  // Pods at the same place have no normal and don't bounce. Pods moving
+  // together get the minimum impulse along the normal, which pushes them
+  // apart, where the referee would divide by 0.
+  static void _bounce(_Pod& a, _Pod& b) {
+    double mcoeff = (a.m + b.m) / (a.m * b.m);
+    double nx = a.x - b.x, ny = a.y - b.y;
+    double nxnysquare = nx * nx + ny * ny;
+    if (nxnysquare == 0.) { return; }
+    double product = nx * (a.vx - b.vx) + ny * (a.vy - b.vy);
+    double fx = (nx * product) / (nxnysquare * mcoeff);
+    double fy = (ny * product) / (nxnysquare * mcoeff);
+    a.vx -= fx / a.m; a.vy -= fy / a.m;
+    b.vx += fx / b.m; b.vy += fy / b.m;
+    double impulse = std::sqrt(fx * fx + fy * fy);
+    if (impulse == 0.) {
+      double n = std::sqrt(nxnysquare);
+      fx = -nx * MIN_IMPULSE / n; fy = -ny * MIN_IMPULSE / n;
+    }
+    else if (impulse < MIN_IMPULSE) { fx = fx * MIN_IMPULSE / impulse; fy = fy * MIN_IMPULSE / impulse; }
+    a.vx -= fx / a.m; a.vy -= fy / a.m;
+    b.vx += fx / b.m; b.vy += fy / b.m;
+  }
+};
+
+// Returns the number of steps during which 2 particles certainly can't touch,
+// given that none of them moves by more than `vmax` in a step: particles at a
+// distance D can't meet for at least D / (2·vmax) steps. The distance is
+// shrunk a little, since `mag` may overestimate it.
+inline int steps_apart(const Particle& a, const Particle& b, int vmax) {
+  int d = mag(pos(a) - pos(b));
+  int gap = d - d / 64 - rad(a) - rad(b);
+  return irel(gap - 1) / (2 * vmax);
+}
+
+// Under BasicDragModel, drag is proportional to speed: a coasting particle
+// loses the same ratio of its speed at each turn and drifts along a geometric
+// series. `coast_ratios` returns that ratio `r`, and the ratio of the
+// previous speed that is travelled during a turn, for each ThrustModel.
+template<int MAX_THRUST, int MAX_VELOCITY>
+inline std::pair<float, float>
+coast_ratios(const Particle&, const InstantThrustModel&,
+             const BasicDragModel<MAX_THRUST, MAX_VELOCITY>&) {
+  float r = 1.f - float(MAX_THRUST) / float(MAX_VELOCITY);
+  return std::make_pair(r, r);
+}
+
+template<int MAX_THRUST, int MAX_VELOCITY>
+inline std::pair<float, float>
+coast_ratios(const Particle& p, const RealisticThrustModel&,
+             const BasicDragModel<MAX_THRUST, MAX_VELOCITY>&) {
+  float k = float(MAX_THRUST) / (float(MAX_VELOCITY) * mass(p));
+  return std::make_pair(1.f - k, 1.f - k / 2.f);
+}
+
+// `coast`, `turns_to_speed` and `stop_distance` are the closed forms of
+// `iterate_reaction` and `until_reaction` with CoastingAction: they answer in
+// constant time for any number of turns. They don't truncate at each turn
+// like the integer steps do, so they drift apart by a few units over time, and
+// slow particles do come to a stop.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline Particle coast(const Particle& p, unsigned turns,
+                      const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  std::pair<float, float> rf = coast_ratios(p, phy.thrustModel(), phy.dragModel());
+  float rn = std::pow(rf.first, float(turns));
+  float sum = rf.second * (1.f - rn) / (1.f - rf.first);
+  return {pos(p) + spd(p) * sum, spd(p) * rn, orient(p), rad(p), mass(p)};
+}
+
+// Number of turns for the particle to slow down to `speed` or less, which
+// must be positive.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline unsigned turns_to_speed(const Particle& p, int speed,
+                               const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  int m = mag(spd(p));
+  if (m <= speed) { return 0; }
+  std::pair<float, float> rf = coast_ratios(p, phy.thrustModel(), phy.dragModel());
+  return unsigned(std::ceil(std::log(float(speed) / float(m)) / std::log(rf.first)));
+}
+
+// Distance travelled by the particle until it stops.
+template<typename ThrustModel, typename DragModel, typename CollisionModel>
+inline int stop_distance(const Particle& p,
+                         const Physics<ThrustModel, DragModel, CollisionModel>& phy) {
+  std::pair<float, float> rf = coast_ratios(p, phy.thrustModel(), phy.dragModel());
+  return int(float(mag(spd(p))) * rf.second / (1.f - rf.first));
+}
+
 // Collision Detection algorithm. Returns the distance of collision, an a
 // posteriori estimate of the closest approach between 2 particles (squared)
 // and the time to collision. When closest approach <= distance of collision,
@@ -557,29 +1450,161 @@ inline Particle until_reaction(Particle p, const Action& a, const Predicate& t,
 // particles. At each turn, the model is updated with the particles' positions,
 // and it queries the thrust for each of the particles.
 //
+// When `vmax`, the highest speed of the particles, is known, steps where they
+// can't touch are not checked, although the particles are still moved, and
+// the estimation stops as soon as they can't touch anymore before max_iter. Particles found faster than `vmax` are
+// checked at each step until they slow down. Collisions are found at the
+// same time as without `vmax`, but when there is none the closest approach
+// only covers the steps that were checked: it is no closer than the exact
+// one, and shouldn't be used to rank near misses.
 template<typename ActionA, typename ActionB, typename Physics>
 inline std::tuple<int, int, int>
 collide_two(Particle a0, Particle b0, const ActionA& ma, const ActionB& mb,
             const Physics& phy, int max_iter = 100,
-            const Box2& bb = {{-10000,-10000}, {10000, 10000}}) {
+            const Box2& bb = {{-10000,-10000}, {10000, 10000}}, int vmax = 0) {
   int sqrad = sq(rad(a0)) + sq(rad(b0));
   int best_approach = distsq(pos(a0), pos(b0));
   if (best_approach <= sqrad)
     { return std::make_tuple(sqrad, best_approach, 0); }
+  int wait = (vmax > 0) ? steps_apart(a0, b0, vmax) : 0;
+  if (wait >= max_iter)
+    { return std::make_tuple(sqrad, best_approach, max_iter); }
   int i = 0;
   for (; i < max_iter; ++i) {
-    Particle a1 = reaction(a0, vec(ma(a0)), phy);
-    Particle b1 = reaction(b0, vec(mb(b0)), phy);
+    Particle a1 = reaction(a0, ma(a0), phy);
+    Particle b1 = reaction(b0, mb(b0), phy);
     if (!within(bb, pos(a1)) || !within(bb, pos(b1))) break;
+    if (wait > 0 && magsq(spd(a1)) <= sq(vmax) && magsq(spd(b1)) <= sq(vmax))
+      { --wait; a0 = a1; b0 = b1; continue; }
     int approach = linear_collide(pos(a0), pos(b0), pos(a1), pos(b1), sqrad);
     if (approach <= sqrad)
       { return std::make_tuple(sqrad, approach, i); }
     if (approach < best_approach) { best_approach = approach; }
+    if (vmax > 0) {
+      wait = steps_apart(a1, b1, vmax);
+      if (i + 1 + wait >= max_iter)
+        { return std::make_tuple(sqrad, best_approach, max_iter); }
+    }
     a0 = a1; b0 = b1;
   }
   return std::make_tuple(sqrad, best_approach, i);
 }
 
+// ContactSchedule is a cache for all-pairs checks between N particles over
+// consecutive steps (or turns). It keeps, for each pair, the earliest step at
+// which both particles could possibly touch, and only emits the pairs that
+// reached it. The earliest step is only refreshed when it is reached, or when
+// either particle was found faster than `vmax`, so most pairs cost nothing
+// most of the time.
+template<unsigned N>
+struct ContactSchedule {
+  explicit ContactSchedule(int vmax) : _vmax(vmax), _step(0) { _earliest.fill(0); }
+
+  // Calls `fn(i, j)` for each pair that could touch during the next step,
+  // given the particles at the start of the step, then moves on to the next.
+  // Only the first N particles are scheduled.
+  template<typename Particles, typename Fn>
+  void operator() (const Particles& ps, Fn fn) {
+    unsigned n = (ps.size() < N) ? unsigned(ps.size()) : N;
+    std::array<bool, N> fast;
+    for (unsigned i = 0; i < n; ++i) { fast[i] = magsq(spd(ps[i])) > sq(_vmax); }
+    for (unsigned i = 0; i < n; ++i) {
+      for (unsigned j = i + 1; j < n; ++j) {
+        int& earliest = _earliest[i * N + j];
+        if (earliest > _step && !fast[i] && !fast[j]) { continue; }
+        fn(i, j);
+        // Fast particles may move by more than `vmax` during this step
+        earliest = _step + ((fast[i] || fast[j]) ? 1 : imax(1, steps_apart(ps[i], ps[j], _vmax)));
+      }
+    }
+    ++_step;
+  }
+
+  int vmax() const { return _vmax; }
+
+  // Emits all the pairs of particle `i` at the next step, e.g. when it moved
+  // faster than `vmax` during the last one.
+  void wake(unsigned i) {
+    for (unsigned j = 0; j < N; ++j) { _earliest[(i < j) ? i * N + j : j * N + i] = 0; }
+  }
+
+  // Forget all the cached steps, e.g. when particles are teleported.
+  void reset() { _earliest.fill(0); _step = 0; }
+
+private:
+  int _vmax;
+  int _step;
+  std::array<int, N * N> _earliest;
+};
+
+// SweepAndPrune is a broad phase for collisions between many particles. It
+// sorts the extents swept by each particle during a step along the x axis, and
+// only emits the pairs of particles whose extents overlap on both axes, as
+// candidates for the narrow phase (`linear_collide`), instead of all n² pairs.
+//
+// The ordering is kept between steps and repaired with an insertion sort, which
+// is close to O(n) since particles move coherently from one step to the
+// next. It is reset whenever the number of particles changes. Up to N particles
+// can be tracked, the others are left out, and no memory is allocated.
+template<unsigned N>
+struct SweepAndPrune {
+  SweepAndPrune() : _size(0) { }
+
+  // Calls `fn(i, j)` for each candidate pair of indices, given the particles
+  // at the start of the step `p0` and at the end of the step `p1`.
+  template<typename Particles, typename Fn>
+  void operator() (const Particles& p0, const Particles& p1, Fn fn) {
+    _resize(p0.size());
+    for (unsigned i = 0; i < _size; ++i)
+      { _extent(i, pos(p0[i]), pos(p1[i]), rad(p0[i])); }
+    _sweep(fn);
+  }
+
+  // Same as above, for particles in linear motion during the step.
+  template<typename Particles, typename Fn>
+  void operator() (const Particles& ps, Fn fn) {
+    _resize(ps.size());
+    for (unsigned i = 0; i < _size; ++i)
+      { _extent(i, pos(ps[i]), pos(ps[i]) + spd(ps[i]), rad(ps[i])); }
+    _sweep(fn);
+  }
+
+private:
+  void _resize(unsigned n) {
+    if (n > N) { n = N; }
+    if (n == _size) { return; }
+    for (unsigned i = 0; i < n; ++i) { _order[i] = i; }
+    _size = n;
+  }
+
+  void _extent(unsigned i, const Vec2& a, const Vec2& b, int r) {
+    _low[i] = {imin(x(a), x(b)) - r, imin(y(a), y(b)) - r};
+    _high[i] = {imax(x(a), x(b)) + r, imax(y(a), y(b)) + r};
+  }
+
+  template<typename Fn>
+  void _sweep(Fn& fn) {
+    for (unsigned i = 1; i < _size; ++i) {
+      unsigned k = _order[i];
+      unsigned j = i;
+      for (; j > 0 && x(_low[_order[j - 1]]) > x(_low[k]); --j)
+        { _order[j] = _order[j - 1]; }
+      _order[j] = k;
+    }
+    for (unsigned i = 0; i < _size; ++i) {
+      unsigned a = _order[i];
+      for (unsigned j = i + 1; j < _size && x(_low[_order[j]]) <= x(_high[a]); ++j) {
+        unsigned b = _order[j];
+        if (y(_low[b]) <= y(_high[a]) && y(_low[a]) <= y(_high[b])) { fn(a, b); }
+      }
+    }
+  }
+
+  unsigned _size;
+  std::array<unsigned, N> _order;
+  std::array<Vec2, N> _low, _high;
+};
+
 // Ring & Anchor are 2 simple objects that store objects in a contiguous location
 // and then rotate addressing to each objects stored.
 //
@@ -655,9 +1680,167 @@ template<unsigned P, typename Tp, unsigned N>
 inline typename Ring<Tp, N>::template Anchor<P> anchor(Ring<Tp, N>& r)
 { return typename Ring<Tp, N>::template Anchor<P>(r); }
 
+// ThreadPool spreads batches of independent tasks, such as rollouts or
+// evaluations, across `threads` workers and the calling thread. Each worker
+// owns a deque of tasks: it takes the last task it was given first, and
+// steals the first task of the others when it runs out, so that uneven tasks
+// still keep every core busy.
+//
+// A task is a range of indices of a batch, and a batch lives on the stack of
+// the caller; each deque is a ring of up to N tasks, and tasks that don't fit
+// run on the caller. Submitting a batch never allocates. Batches are
+// submitted by one thread at a time, which takes part in them until they're
+// done. With no worker, batches simply run on the calling thread.
+template<unsigned N = 256>
+struct ThreadPool {
+  explicit ThreadPool(unsigned threads) : _deques(new _Deque[threads]), _size(threads) {
+    _threads.reserve(threads);
+    for (unsigned w = 0; w < threads; ++w) { _threads.emplace_back([this, w] { _work(w); }); }
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ~ThreadPool() {
+    { std::lock_guard<std::mutex> lock(_sleep); _stop = true; }
+    _wake.notify_all();
+    for (std::thread& t : _threads) { t.join(); }
+  }
+
+  unsigned size() const { return _size; }
+
+  // Calls `fn(i)` for each index `i` in [0, n), in tasks of `grain`
+  // consecutive indices, and returns once all are done.
+  template<typename Fn>
+  void for_each(int n, Fn fn, int grain = 1) {
+    auto range = [&fn](int begin, int end) { for (int i = begin; i < end; ++i) { fn(i); } };
+    _submit(n, grain, range);
+  }
+
+  // Returns the index `i` in [0, n) with the highest `score(i)`, or -1 if n is
+  // 0. Ties go to the lowest index, so that the result doesn't depend on the
+  // scheduling of tasks. The best score is written to `value`, if any.
+  template<typename Score, typename Tp = decltype(std::declval<Score&>()(0))>
+  int best(int n, Score score, int grain = 1, Tp* value = nullptr) {
+    int best = -1;
+    Tp top = Tp();
+    std::mutex merge;
+    auto range = [&](int begin, int end) {
+      int b = begin;
+      Tp v = score(begin);
+      for (int i = begin + 1; i < end; ++i) {
+        Tp s = score(i);
+        if (v < s) { v = s; b = i; }
+      }
+      std::lock_guard<std::mutex> lock(merge);
+      if (best < 0 || top < v || (!(v < top) && b < best)) { best = b; top = v; }
+    };
+    _submit(n, grain, range);
+    if (value && best >= 0) { *value = top; }
+    return best;
+  }
+
+private:
+  struct _Batch {
+    void (*run)(void*, int, int);
+    void* fn;
+    std::atomic<int> pending;
+  };
+
+  struct _Task {
+    _Batch* batch;
+    int begin, end;
+  };
+
+  struct _Deque {
+    bool push(const _Task& t) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_size == N) { return false; }
+      _tasks[(_front + _size++) % N] = t;
+      return true;
+    }
+
+    bool back(_Task& t) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_size == 0) { return false; }
+      t = _tasks[(_front + --_size) % N];
+      return true;
+    }
+
+    bool front(_Task& t) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_size == 0) { return false; }
+      t = _tasks[_front];
+      _front = (_front + 1) % N;
+      --_size;
+      return true;
+    }
+
+  private:
+    std::mutex _mutex;
+    std::array<_Task, N> _tasks;
+    unsigned _front = 0, _size = 0;
+  };
+
+  template<typename Range>
+  static void _run(void* fn, int begin, int end) { (*static_cast<Range*>(fn))(begin, end); }
+
+  template<typename Range>
+  void _submit(int n, int grain, Range& range) {
+    if (n <= 0) { return; }
+    if (_size == 0) { range(0, n); return; }
+    _Batch b;
+    b.run = &_run<Range>;
+    b.fn = &range;
+    b.pending.store((n + grain - 1) / grain, std::memory_order_relaxed);
+    unsigned w = 0;
+    for (int begin = 0; begin < n; begin += grain) {
+      _Task t = {&b, begin, std::min(n, begin + grain)};
+      _queued.fetch_add(1);
+      if (!_deques[w].push(t)) { _queued.fetch_sub(1); _execute(t); }
+      if (++w == size()) { w = 0; }
+    }
+    { std::lock_guard<std::mutex> lock(_sleep); }
+    _wake.notify_all();
+    while (b.pending.load(std::memory_order_acquire) > 0) {
+      _Task t;
+      if (_take(size(), t)) { _execute(t); } else { std::this_thread::yield(); }
+    }
+  }
+
+  // Takes a task from the back of the deque of worker `w`, or steals one
+  // from the front of another deque.
+  bool _take(unsigned w, _Task& t) {
+    bool found = w < size() && _deques[w].back(t);
+    for (unsigned k = 1; !found && k <= size(); ++k) { found = _deques[(w + k) % size()].front(t); }
+    if (found) { _queued.fetch_sub(1); }
+    return found;
+  }
+
+  static void _execute(const _Task& t) {
+    t.batch->run(t.batch->fn, t.begin, t.end);
+    t.batch->pending.fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  void _work(unsigned w) {
+    for (;;) {
+      _Task t;
+      if (_take(w, t)) { _execute(t); continue; }
+      std::unique_lock<std::mutex> lock(_sleep);
+      _wake.wait(lock, [this] { return _stop || _queued.load() > 0; });
+      if (_stop) { return; }
+    }
+  }
+
+  std::unique_ptr<_Deque[]> _deques;
+  const unsigned _size;
+  std::vector<std::thread> _threads;
+  std::atomic<int> _queued{0};
+  std::mutex _sleep;
+  std::condition_variable _wake;
+  bool _stop = false;
+};
+
 #endif // SYLVAIN__CODINGAME_INCLUDED
 
-#include <vector>
+#include <chrono>
 
 using std::cout;
 using std::cin;
@@ -689,9 +1872,15 @@ constexpr inline Vec2 to_local(const Vec2& v) {
   return v + Vec2{MAP_SEMI_WIDTH, MAP_SEMI_HEIGHT};
 }
 
+// Besides what the referee gives each turn, the state keeps the laps, the
+// turns left before a shielded pod can accelerate again, and whether its boost
+// is still available.
 struct State {
   array<Particle, 4> pods;
   array<int, 4> cps;
+  array<int, 4> laps;
+  array<int, 4> shieldTurns;
+  array<bool, 4> boosts;
 };
 
 enum { my1 = 0, my2 = 1, th1 = 2, th2 = 3 };
@@ -701,6 +1890,9 @@ inline State initState() {
   for (int i = 0; i < 4; ++i) {
     s.pods[i] = {{0, 0}, {0, 0}, 0, POD_RADIUS, POD_MASS};
     s.cps[i] = 0;
+    s.laps[i] = 0;
+    s.shieldTurns[i] = 0;
+    s.boosts[i] = true;
   }
   return s;
 }
@@ -720,9 +1912,12 @@ inline State& readState(State& s) {
   return s;
 }
 
+// The map also keeps the bounding box of each checkpoint, to quickly reject
+// the pods that can't cross it during a step.
 struct Map {
   int numLaps;
   vector<Vec2> cps;
+  vector<Box2> cpBoxes;
 };
 
 inline Map readMap() {
@@ -731,14 +1926,111 @@ inline Map readMap() {
   int checkPointCount;
   cin >> checkPointCount; cin.ignore();
   m.cps.reserve(checkPointCount);
+  m.cpBoxes.reserve(checkPointCount);
   for (int i = 0; i < checkPointCount; ++i) {
     int x, y;
     cin >> x >> y; cin.ignore();
     m.cps.push_back(to_centered({x, y}));
+    m.cpBoxes.push_back({m.cps[i] - Vec2{CP_RADIUS, CP_RADIUS},
+                         m.cps[i] + Vec2{CP_RADIUS + 1, CP_RADIUS + 1}});
   }
   return m;
 }
 
+// Returns whether a pod moving from `p0` to `p1` during a step crossed the
+// checkpoint `cp`, even when going through it at high speed. A pod that
+// bounced during the step is taken as going straight from `p0` to `p1`,
+// whereas the referee follows its path through the bounce: the checkpoint
+// is missed when only the path before or after the bounce goes through it.
+inline bool crossed(const Map& m, int cp, const Vec2& p0, const Vec2& p1) {
+  const Box2& b = m.cpBoxes[cp];
+  if (imax(x(p0), x(p1)) < x(low(b)) || imin(x(p0), x(p1)) >= x(high(b))
+      || imax(y(p0), y(p1)) < y(low(b)) || imin(y(p0), y(p1)) >= y(high(b)))
+    { return false; }
+  return swept_within(p0, p1, m.cps[cp], sq(CP_RADIUS));
+}
+
+// Rollout hook: once the pods in `s` have moved from their positions in
+// `prev`, advance the next checkpoints of those that crossed theirs, and count
+// a lap each time checkpoint 0 is crossed.
+inline void advanceCheckpoint(State& s, int i, const Vec2& from, const Map& m) {
+  if (!crossed(m, s.cps[i], from, pos(s.pods[i]))) return;
+  if (s.cps[i] == 0) { ++s.laps[i]; }
+  s.cps[i] = (s.cps[i] + 1) % int(m.cps.size());
+}
+
+inline State& advanceCheckpoints(State& s, const State& prev, const Map& m) {
+  for (int i = 0; i < 4; ++i) { advanceCheckpoint(s, i, pos(prev.pods[i]), m); }
+  return s;
+}
+
+// The referee only gives the next checkpoint: laps are counted when it moves
+// away from checkpoint 0. Shields and boosts are carried over from `prev`.
+inline State& countLaps(State& s, const State& prev) {
+  for (int i = 0; i < 4; ++i) {
+    s.laps[i] = prev.laps[i] + ((prev.cps[i] == 0 && s.cps[i] != 0) ? 1 : 0);
+    s.shieldTurns[i] = prev.shieldTurns[i];
+    s.boosts[i] = prev.boosts[i];
+  }
+  return s;
+}
+
+// What a pod plays on a turn: a target and a thrust, or BOOST, or SHIELD.
+struct Command {
+  Vec2 target;
+  int thrust;
+  bool boost;
+  bool shield;
+};
+
+constexpr const int SHIELD_TURNS = 3; // turns without thrust after a shield
+
+// Returns the thrust pod `i` really gets when playing `c`, and updates its
+// boost and shield: a boost is only available once, and a pod can't thrust
+// while its shield is up, nor use its boost, which it keeps for later.
+inline int spend(State& s, int i, const Command& c) {
+  int t = imin(c.thrust, MAX_THRUST);
+  if (s.shieldTurns[i] > 0) { t = 0; --s.shieldTurns[i]; }
+  else if (c.boost && s.boosts[i]) { t = BOOST_THRUST; s.boosts[i] = false; }
+  if (c.shield) { s.shieldTurns[i] = SHIELD_TURNS; }
+  return t;
+}
+
+// Plays a full turn for the 4 pods like the referee does, in place and
+// without allocation: pods rotate toward their target within the limit,
+// thrust, boost or shield, bounce on each other, move, cross their
+// checkpoints, and then lose speed to friction. On the first turn, pods
+// rotate freely.
+inline State& simulate(State& s, const Map& m, const array<Command, 4>& cmds,
+                       bool first = false) {
+  static constexpr const CsbPhysics csb = CsbPhysics();
+  array<CsbCommand, 4> c;
+  State prev = s;
+  for (int i = 0; i < 4; ++i) { c[i] = {cmds[i].target, spend(s, i, cmds[i]), cmds[i].shield}; }
+  csb(s.pods, c, first);
+  return advanceCheckpoints(s, prev, m);
+}
+
+// Same as above for some of the pods only, as if the others weren't there.
+template<std::size_t N>
+inline State& simulate(State& s, const Map& m, const array<int, N>& pods,
+                       const array<Command, N>& cmds, bool first = false) {
+  static constexpr const CsbPhysics csb = CsbPhysics();
+  array<CsbCommand, N> c;
+  array<Particle, N> ps;
+  for (std::size_t k = 0; k < N; ++k) {
+    ps[k] = s.pods[pods[k]];
+    c[k] = {cmds[k].target, spend(s, pods[k], cmds[k]), cmds[k].shield};
+  }
+  csb(ps, c, first);
+  for (std::size_t k = 0; k < N; ++k) {
+    Vec2 from = pos(s.pods[pods[k]]);
+    s.pods[pods[k]] = ps[k];
+    advanceCheckpoint(s, pods[k], from, m);
+  }
+  return s;
+}
+
 typedef Ring<State, 3> History;
 
 inline void thrust(int x, int y, int t) {
@@ -749,12 +2041,12 @@ inline void thrust(const Vec2& p, int t) {
   thrust(x(l), y(l), t);
 }
 
-inline void boost(int x, int y) {
+inline void boostTo(int x, int y) {
     cout << x << " " << y << " BOOST" << endl;
 }
-inline void boost(const Vec2& p) {
+inline void boostTo(const Vec2& p) {
   Vec2 l = to_local(p);
-  boost(x(l), y(l));
+  boostTo(x(l), y(l));
 }
 
 inline void shield(int x, int y) {
@@ -765,22 +2057,893 @@ inline void shield(const Vec2& p) {
   shield(x(l), y(l));
 }
 
+inline void play(const Command& c) {
+  if (c.shield) { shield(c.target); }
+  else if (c.boost) { boostTo(c.target); }
+  else { thrust(c.target, c.thrust); }
+}
+
+// The greedy policy: AdvTargetAction toward the next checkpoint. It is the
+// model of the opponents in rollouts, and the seed of the plans.
+inline Command greedy(const State& s, const Map& m, int i) {
+  const Particle& p = s.pods[i];
+  Ray2 push = AdvTargetAction<MAX_THRUST, MAX_POD_ROTATION>(m.cps[s.cps[i]], CP_RADIUS - 50)(p);
+  return {pos(p) + vec({angle(push), 2000}), rad(push), false, false};
+}
+
+// Moves are relative to the pod: a rotation within the limit and a thrust, or
+// a BOOST, or a SHIELD.
+struct Move {
+  int rotation;
+  int thrust;
+  bool boost;
+  bool shield;
+};
+
+// The command for pod `p` playing move `mv`: a target far along its new
+// orientation, computed in doubles so that the referee finds it exactly.
+inline Command command(const Particle& p, const Move& mv) {
+  double a = (orient(p) + mv.rotation) * M_PI / 180.;
+  Vec2 d = {int(std::lround(std::cos(a) * 10000.)), int(std::lround(std::sin(a) * 10000.))};
+  return {pos(p) + d, mv.thrust, mv.boost, mv.shield};
+}
+
+// The move closest to the command `c` for pod `p`.
+inline Move move(const Particle& p, const Command& c) {
+  int d = adiff(angle(ray(c.target - pos(p))), orient(p));
+  return {isgn(d, imin(iabs(d), MAX_POD_ROTATION)), c.thrust, c.boost, c.shield};
+}
+
+// A move packed in 2 bytes, for populations and plans: the rotation offset by
+// MAX_POD_ROTATION in bits 0-5, the thrust in bits 6-12, then the boost and
+// the shield.
+typedef std::uint16_t PackedMove;
+
+constexpr const PackedMove ROTATION_BITS = 0x003f;
+constexpr const PackedMove THRUST_BITS   = 0x1fc0;
+constexpr const PackedMove BOOST_BIT     = 0x2000;
+constexpr const PackedMove SHIELD_BIT    = 0x4000;
+
+constexpr PackedMove pack(const Move& mv) {
+  return PackedMove((mv.rotation + MAX_POD_ROTATION) | (mv.thrust << 6)
+                    | (mv.boost ? BOOST_BIT : 0) | (mv.shield ? SHIELD_BIT : 0));
+}
+
+constexpr Move unpack(PackedMove pm) {
+  return {(pm & ROTATION_BITS) - MAX_POD_ROTATION, (pm & THRUST_BITS) >> 6,
+          (pm & BOOST_BIT) != 0, (pm & SHIELD_BIT) != 0};
+}
+
+// The packed move closest to the command `c` for pod `p`, and back.
+inline PackedMove encode(const Particle& p, const Command& c) { return pack(move(p, c)); }
+inline Command decode(const Particle& p, PackedMove pm) { return command(p, unpack(pm)); }
+
+// The bits of `mask` from `a`, and the other bits from `b`. Masks of whole
+// fields keep moves valid.
+constexpr PackedMove cross(PackedMove a, PackedMove b, PackedMove mask) {
+  return PackedMove((a & mask) | (b & ~mask));
+}
+
+// The crossover of `a` and `b`, gene by gene or field by field, as per
+// `masks`. The result is returned rather than written in place, so that the
+// loop is vectorized without checking whether the arrays overlap.
+template <std::size_t N>
+inline array<PackedMove, N> crossover(const array<PackedMove, N>& a, const array<PackedMove, N>& b,
+                                      const array<PackedMove, N>& masks) {
+  array<PackedMove, N> child;
+  for (std::size_t g = 0; g < N; ++g) { child[g] = cross(a[g], b[g], masks[g]); }
+  return child;
+}
+
+// `genes` with the bits selected by `masks` replaced with those of `noise`.
+template <std::size_t N>
+inline array<PackedMove, N> mutate(const array<PackedMove, N>& genes, const array<PackedMove, N>& noise,
+                                   const array<PackedMove, N>& masks) {
+  array<PackedMove, N> mutant;
+  for (std::size_t g = 0; g < N; ++g) { mutant[g] = cross(noise[g], genes[g], masks[g]); }
+  return mutant;
+}
+
+// Progress of pod `i` in the race: checkpoints passed, then closeness to the
+// next one.
+inline int progress(const State& s, const Map& m, int i) {
+  int n = m.cps.size();
+  int passed = s.laps[i] * n + ((s.cps[i] == 0) ? n : s.cps[i]);
+  return passed * 50000 - mag(m.cps[s.cps[i]] - pos(s.pods[i]));
+}
+
+// Our racer `my1` goes on, `my2` helps, the leading opponent is slowed. The
+// roles are fixed: `my2` plays the Blocker.
+inline int evaluate(const State& s, const Map& m) {
+  int th = imax(progress(s, m, th1), progress(s, m, th2));
+  return 2 * progress(s, m, my1) + progress(s, m, my2) / 2 - th;
+}
+
+// Xorshift: cheap, and reproducible from one run to the other.
+struct Random {
+  std::uint32_t s = 2463534242u;
+  std::uint32_t operator() () { s ^= s << 13; s ^= s >> 17; s ^= s << 5; return s; }
+  int operator() (int n) { return int((*this)() % unsigned(n)); }
+};
+
+constexpr const int PLAN_DEPTH = 6;
+constexpr const int CONTACT_MARGIN = 50; // pods' motion is only linear between bumps
+
+// OpponentCache plays the opponents alone with the greedy model once per
+// turn, for PLAN_DEPTH turns, so that rollouts don't have to: `play` moves
+// only our pods, and takes the opponents from the cache, as long as none of
+// our pods came close enough to touch one of them.
+struct OpponentCache {
+  void operator() (const State& root, const Map& m, bool first) {
+    _states[0] = root;
+    for (int d = 0; d < PLAN_DEPTH; ++d) {
+      _states[d + 1] = _states[d];
+      State& s = _states[d + 1];
+      simulate(s, m, array<int, 2>{{th1, th2}},
+               array<Command, 2>{{greedy(s, m, th1), greedy(s, m, th2)}}, first && d == 0);
+    }
+  }
+
+  // Plays turn `d` of a rollout with the commands of our pods. Returns false,
+  // and leaves `s` unchanged, if they might touch an opponent.
+  bool play(State& s, const Map& m, int d, const Command& c1, const Command& c2,
+            bool first = false) const {
+    State n = s;
+    simulate(n, m, array<int, 2>{{my1, my2}}, array<Command, 2>{{c1, c2}}, first);
+    const State& o0 = _states[d];
+    const State& o1 = _states[d + 1];
+    for (int i : {my1, my2}) {
+      for (int j : {th1, th2}) {
+        if (swept_within(pos(s.pods[i]) - pos(o0.pods[j]), pos(n.pods[i]) - pos(o1.pods[j]),
+                         {0, 0}, sq(2 * POD_RADIUS + CONTACT_MARGIN))) { return false; }
+      }
+    }
+    for (int j : {th1, th2}) {
+      n.pods[j] = o1.pods[j]; n.cps[j] = o1.cps[j]; n.laps[j] = o1.laps[j];
+      n.shieldTurns[j] = o1.shieldTurns[j]; n.boosts[j] = o1.boosts[j];
+    }
+    s = n;
+    return true;
+  }
+
+private:
+  array<State, PLAN_DEPTH + 1> _states;
+};
+
+#ifndef ROLLOUT_THREADS
+#define ROLLOUT_THREADS 0 // workers helping the planner with its rollouts
+#endif
+
+constexpr const int POPULATION = 32;
+constexpr const int GENES      = 2 * PLAN_DEPTH; // moves of my1, then of my2
+
+typedef array<PackedMove, GENES> Plan;
+
+typedef std::chrono::steady_clock Clock;
+
+constexpr const int FIRST_TURN_MS      = 1000; // the referee's limits
+constexpr const int TURN_MS            = 75;
+constexpr const int FIRST_TURN_SLACK   = 100;  // ms left when the search stops
+constexpr const int TURN_SLACK         = 10;
+constexpr const int WATCHDOG_SLACK     = 3;    // ms left when the fallback is played
+constexpr const int CHECK_US           = 20;   // wanted time between clock reads
+
+// TurnBudget times a turn from the first byte of its input, since the time
+// spent waiting for the referee doesn't count. `expired` is cheap enough to
+// be called in the inner loops of the searches: the clock is only read every
+// `_stride` calls, and the stride is calibrated as it goes so that reads are
+// about CHECK_US apart, whatever the cost of a call. A watchdog thread plays
+// the fallback commands of the turn if we haven't answered just before the
+// limit, and `answer` tells whether we still have to.
+struct TurnBudget {
+  TurnBudget() : _watchdog([this] { _watch(); }) { }
+
+  ~TurnBudget() {
+    { std::lock_guard<std::mutex> lock(_mutex); _stop = true; }
+    _wake.notify_one();
+    _watchdog.join();
+  }
+
+  // Waits for the input of the turn, and starts timing it.
+  void start(bool first) {
+    cin >> std::ws;
+    _start = Clock::now();
+    _limit = _start + std::chrono::milliseconds(first ? FIRST_TURN_MS : TURN_MS);
+    _search = _limit - std::chrono::milliseconds(first ? FIRST_TURN_SLACK : TURN_SLACK);
+    _deadline = _search;
+    _calls = 0;
+  }
+
+  // Arms the watchdog with the commands of our pods to play if we're late.
+  void fallback(const Command& c1, const Command& c2) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _fallback = {c1, c2};
+      _alarm = _limit - std::chrono::milliseconds(WATCHDOG_SLACK);
+      _armed = true;
+    }
+    _wake.notify_one();
+  }
+
+  // Disarms the watchdog, and returns false if it has already answered.
+  bool answer() {
+    bool armed;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      armed = _armed;
+      _armed = false;
+    }
+    _wake.notify_one();
+    return armed;
+  }
+
+  // Sets the deadline of `expired` to `percent` of the search time.
+  void share(int percent) { _deadline = _start + (_search - _start) * percent / 100; }
+
+  Clock::time_point deadline() const { return _deadline; }
+
+  bool expired() {
+    if (++_calls < _stride) { return false; }
+    _calls = 0;
+    auto now = Clock::now();
+    auto since = now - _last;
+    _last = now;
+    if (since < std::chrono::microseconds(CHECK_US / 2)) { _stride = imin(2 * _stride, 1 << 16); }
+    else if (since > std::chrono::microseconds(CHECK_US)) { _stride = imax(1, _stride / 2); }
+    return now >= _deadline;
+  }
+
+  // Milliseconds since the start of the turn.
+  int elapsed() const {
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _start).count());
+  }
+
+private:
+  void _watch() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop) {
+      if (!_armed) { _wake.wait(lock); }
+      else if (Clock::now() < _alarm) { _wake.wait_until(lock, _alarm); }
+      else {
+        _armed = false;
+        for (const Command& c : _fallback) { play(c); }
+        cerr << "Watchdog\tfallback played" << endl;
+      }
+    }
+  }
+
+  Clock::time_point _start, _limit, _search, _deadline, _last;
+  int _stride = 1;
+  int _calls = 0;
+  // Shared with the watchdog.
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  array<Command, 2> _fallback;
+  Clock::time_point _alarm;
+  bool _armed = false;
+  bool _stop = false;
+  std::thread _watchdog; // last, once the rest is initialized
+};
+
+// Evolves plans of PLAN_DEPTH moves for both of our pods against greedy
+// opponents, until the budget expires, and keeps the best plan found. Each
+// generation replaces the worst half of the population by children of the
+// best half. The population is an array of packed plans, allocated once.
+// Rollouts are spread across ROLLOUT_THREADS workers, if any; the random
+// draws stay on the calling thread, so that plans don't depend on them.
+struct Planner {
+  static constexpr const char* EFFORT = "Generations";
+
+  // Returns the number of generations. The search is seeded with the `warm`
+  // plan, if any.
+  int operator() (const State& root, const Map& m, bool first, TurnBudget& budget,
+                  const Plan* warm = nullptr) {
+    _prepare(root, m, first);
+    seed(warm);
+    return _evolve([&budget] { return budget.expired(); });
+  }
+
+  // Same as above from a predicted state, on the worker thread of Ponder,
+  // until `stop` is set.
+  int ponder(const State& predicted, const Map& m, const Plan& warm, const std::atomic<bool>& stop) {
+    _prepare(predicted, m, false);
+    seed(&warm);
+    return _evolve([&stop] { return stop.load(std::memory_order_relaxed); });
+  }
+
+  // Goes on with the pondered population, once rescored from the actual
+  // state of the turn.
+  int resume(const State& root, const Map& m, bool first, TurnBudget& budget) {
+    _prepare(root, m, first);
+    _rollouts(0, POPULATION);
+    return _evolve([&budget] { return budget.expired(); });
+  }
+
+  // Starts from the greedy plan, the warm plan, and their mutations.
+  void seed(const Plan* warm = nullptr) {
+    State s = *_root;
+    for (int d = 0; d < PLAN_DEPTH; ++d) {
+      array<Command, 4> cmds;
+      for (int i = 0; i < 4; ++i) { cmds[i] = greedy(s, *_map, i); }
+      _genes[0][d] = encode(s.pods[my1], cmds[my1]);
+      _genes[0][PLAN_DEPTH + d] = encode(s.pods[my2], cmds[my2]);
+      simulate(s, *_map, cmds, _first && d == 0);
+    }
+    int seeds = 1;
+    if (warm) {
+      _genes[1] = *warm;
+      seeds = 2;
+    }
+    for (int k = seeds; k < POPULATION; ++k) {
+      _genes[k] = _genes[k % seeds];
+      for (int n = 0; n < 1 + k % 4; ++n) { mutate(k); }
+    }
+    for (int k = 0; k < POPULATION; ++k) { _order[k] = k; }
+    _rollouts(0, POPULATION);
+  }
+
+  void generation() {
+    std::sort(_order.begin(), _order.end(), [this](int a, int b) { return _score[a] > _score[b]; });
+    for (int k = POPULATION / 2; k < POPULATION; ++k) {
+      int c = _order[k];
+      int a = _order[_random(POPULATION / 2)], b = _order[_random(POPULATION / 2)];
+      std::uint32_t mask = _random();
+      Plan masks;
+      for (int g = 0; g < GENES; ++g) { masks[g] = PackedMove(-((mask >> g) & 1)); }
+      _genes[c] = crossover(_genes[a], _genes[b], masks);
+      mutate(c);
+    }
+    _rollouts(POPULATION / 2, POPULATION);
+  }
+
+  // Toggles a flag, or draws a new rotation or thrust, of a random gene.
+  void mutate(int k) {
+    static constexpr const PackedMove FIELDS[8] = {
+      BOOST_BIT, SHIELD_BIT, ROTATION_BITS, ROTATION_BITS, ROTATION_BITS,
+      THRUST_BITS, THRUST_BITS, THRUST_BITS
+    };
+    PackedMove& gene = _genes[k][_random(GENES)];
+    Move drawn = {_random(2 * MAX_POD_ROTATION + 1) - MAX_POD_ROTATION,
+                  imin(MAX_THRUST, _random(MAX_THRUST + 50)), false, false};
+    PackedMove noise = PackedMove(pack(drawn) | (~gene & (BOOST_BIT | SHIELD_BIT)));
+    gene = cross(noise, gene, FIELDS[_random(8)]);
+  }
+
+  // Opponents come from the cache until our pods come close to them.
+  int rollout(int k) const {
+    State s = *_root;
+    bool alone = true;
+    for (int d = 0; d < PLAN_DEPTH; ++d) {
+      array<Command, 4> cmds;
+      cmds[my1] = decode(s.pods[my1], _genes[k][d]);
+      cmds[my2] = decode(s.pods[my2], _genes[k][PLAN_DEPTH + d]);
+      if (alone && _opponents.play(s, *_map, d, cmds[my1], cmds[my2], _first && d == 0)) { continue; }
+      alone = false;
+      cmds[th1] = greedy(s, *_map, th1);
+      cmds[th2] = greedy(s, *_map, th2);
+      simulate(s, *_map, cmds, _first && d == 0);
+    }
+    return evaluate(s, *_map);
+  }
+
+  // The next move of our pod `i` in the best plan.
+  Move best(int i) const { return unpack(_genes[_fittest()][(i == my1) ? 0 : PLAN_DEPTH]); }
+
+  Plan plan() const { return _genes[_fittest()]; }
+
+private:
+  void _prepare(const State& root, const Map& m, bool first) {
+    _root = &root; _map = &m; _first = first;
+    _opponents(root, m, first);
+  }
+
+  // Scores the plans from `_order[begin]` to `_order[end - 1]`.
+  void _rollouts(int begin, int end) {
+    _pool.for_each(end - begin, [this, begin](int j) {
+      int k = _order[begin + j];
+      _score[k] = rollout(k);
+    });
+  }
+
+  template <class Done>
+  int _evolve(Done done) {
+    int g = 0;
+    for (; !done(); ++g) { generation(); }
+    return g;
+  }
+
+  int _fittest() const {
+    return int(std::max_element(_score.begin(), _score.end()) - _score.begin());
+  }
+
+  // Whole plans, 2 bytes per gene, rather than an array per field across the
+  // population: crossover reads 2 random parents gene by gene, which is a
+  // vectorized loop within a plan, and a gather across arrays.
+  array<Plan, POPULATION> _genes;
+  array<int, POPULATION> _score;
+  array<int, POPULATION> _order;
+  Random _random;
+  OpponentCache _opponents;
+  ThreadPool<> _pool{ROLLOUT_THREADS};
+  const State* _root = nullptr;
+  const Map* _map = nullptr;
+  bool _first = false;
+};
+
+// The small set of moves of the searches: rotation -18/0/+18 x thrust
+// 0/100/BOOST, and SHIELD.
+constexpr const int DISCRETE_MOVES = 10;
+
+inline Move discrete(int k) {
+  if (k == 9) { return {0, 0, false, true}; }
+  return {(k % 3 - 1) * MAX_POD_ROTATION, (k / 3 == 0) ? 0 : MAX_THRUST, k / 3 == 2, false};
+}
+
+constexpr const int BEAM_DEPTH     = 6;
+constexpr const int BEAM_MAX_WIDTH = 512;
+constexpr const int BEAM_MOVES     = 9;  // the discrete moves, without SHIELD
+constexpr const int BEAM_JOINT     = BEAM_MOVES * BEAM_MOVES; // for both pods
+constexpr const int BEAM_SEEN      = 4096; // power of 2
+
+// Beam search over a small set of moves for both of our pods, against greedy
+// opponents: each state of the beam is expanded with all joint moves, and the
+// best states by `evaluate` make the beam at the next depth. States whose pods
+// are the same once quantized are only kept once. The width is chosen at each
+// depth from the time left and the time spent per state so far, so that the
+// search ends at the deadline. It has the same interface as the Planner.
+struct BeamSearch {
+  static constexpr const char* EFFORT = "Width";
+
+  // Returns the width of the last beam. It always starts from the root: warm
+  // plans are ignored.
+  int operator() (const State& root, const Map& m, bool first, TurnBudget& budget,
+                  const Plan* = nullptr) {
+    Clock::time_point deadline = budget.deadline();
+    _beam[0] = root;
+    _first[0] = 0;
+    int width = 1;
+    int next = BEAM_MAX_WIDTH;
+    _best = _greedy(root, m);
+    for (int d = 0; d < BEAM_DEPTH; ++d) {
+      auto start = Clock::now();
+      int n = 0;
+      bool late = false;
+      // Checked for each child, as a parent takes BEAM_JOINT simulations
+      for (int b = 0; b < width && !late; ++b) {
+        for (int j = 0; j < BEAM_JOINT && !(late = budget.expired()); ++j) {
+          State s = _beam[b];
+          _play(s, m, j, first && d == 0);
+          _children[n++] = {evaluate(s, m), b, j};
+        }
+      }
+      if (n == 0) { break; }
+      auto end = Clock::now();
+      if (d + 1 < BEAM_DEPTH && end < deadline) {
+        double per_state = std::chrono::duration<double>(end - start).count() / n;
+        double left = std::chrono::duration<double>(deadline - end).count();
+        next = int(left / (per_state * BEAM_JOINT * (BEAM_DEPTH - d - 1)));
+        next = imax(1, imin(next, BEAM_MAX_WIDTH));
+      }
+      int k = imin(n, 2 * next);
+      std::partial_sort(_children.begin(), _children.begin() + k, _children.begin() + n,
+                        [](const _Child& a, const _Child& b) { return a.score > b.score; });
+      ++_stamp;
+      int w = 0;
+      for (int c = 0; c < k && w < next; ++c) {
+        State s = _beam[_children[c].parent];
+        _play(s, m, _children[c].move, first && d == 0);
+        std::uint64_t h = _hash(s);
+        unsigned slot = unsigned(h) & (BEAM_SEEN - 1);
+        while (_seen[slot].stamp == _stamp && _seen[slot].hash != h) { slot = (slot + 1) & (BEAM_SEEN - 1); }
+        if (_seen[slot].stamp == _stamp) { continue; } // duplicate
+        _seen[slot] = {h, _stamp};
+        _next[w] = s;
+        _nextFirst[w] = (d == 0) ? _children[c].move : _first[_children[c].parent];
+        ++w;
+      }
+      std::swap(_beam, _next);
+      std::swap(_first, _nextFirst);
+      width = w;
+      _best = _first[0];
+      if (Clock::now() >= deadline) { break; }
+    }
+    return width;
+  }
+
+  // Beams don't carry over to the next turn: there is nothing to ponder.
+  int ponder(const State&, const Map&, const Plan&, const std::atomic<bool>&) { return 0; }
+
+  int resume(const State& root, const Map& m, bool first, TurnBudget& budget) {
+    return (*this)(root, m, first, budget);
+  }
+
+  // The next move of our pod `i` in the best sequence.
+  Move best(int i) const { return discrete((i == my1) ? _best % BEAM_MOVES : _best / BEAM_MOVES); }
+
+  // Only the next moves are known, then pods go straight.
+  Plan plan() const {
+    Plan p;
+    p.fill(pack(discrete(4)));
+    p[0] = pack(best(my1));
+    p[PLAN_DEPTH] = pack(best(my2));
+    return p;
+  }
+
+private:
+  struct _Child { int score, parent, move; };
+  struct _Seen { std::uint64_t hash; unsigned stamp; };
+
+  // The joint move closest to the greedy policy, until the search finds better.
+  static int _greedy(const State& s, const Map& m) {
+    int j = 0;
+    for (int i : {my2, my1}) {
+      Move mv = move(s.pods[i], greedy(s, m, i));
+      int r = (mv.rotation <= -MAX_POD_ROTATION / 2) ? 0 : (mv.rotation >= MAX_POD_ROTATION / 2) ? 2 : 1;
+      j = j * BEAM_MOVES + r + ((mv.thrust >= MAX_THRUST / 2) ? 3 : 0);
+    }
+    return j;
+  }
+
+  static void _play(State& s, const Map& m, int joint, bool first) {
+    array<Command, 4> cmds;
+    cmds[my1] = command(s.pods[my1], discrete(joint % BEAM_MOVES));
+    cmds[my2] = command(s.pods[my2], discrete(joint / BEAM_MOVES));
+    cmds[th1] = greedy(s, m, th1);
+    cmds[th2] = greedy(s, m, th2);
+    simulate(s, m, cmds, first);
+  }
+
+  // Our pods, quantized, and their progress.
+  static std::uint64_t _hash(const State& s) {
+    std::uint64_t h = 14695981039346656037ull;
+    for (int i : {my1, my2}) {
+      const Particle& p = s.pods[i];
+      for (int v : {x(pos(p)) / 32, y(pos(p)) / 32, x(spd(p)) / 8, y(spd(p)) / 8,
+                    orient(p) / 4, s.cps[i], s.laps[i], int(s.boosts[i])})
+        { h = (h ^ std::uint64_t(std::uint32_t(v))) * 1099511628211ull; }
+    }
+    return h;
+  }
+
+  array<State, BEAM_MAX_WIDTH> _beam, _next;
+  array<int, BEAM_MAX_WIDTH> _first, _nextFirst;
+  array<_Child, BEAM_MAX_WIDTH * BEAM_JOINT> _children;
+  array<_Seen, BEAM_SEEN> _seen = {};
+  unsigned _stamp = 0;
+  int _best = 0;
+};
+
+// Build with -DBEAM_SEARCH to play with the beam search instead.
+#ifdef BEAM_SEARCH
+typedef BeamSearch Search;
+#else
+typedef Planner Search;
+#endif
+
+// The leading opponent.
+inline int leader(const State& s, const Map& m) {
+  return (progress(s, m, th1) >= progress(s, m, th2)) ? th1 : th2;
+}
+
+constexpr const int BLOCK_MAX_DEPTH = 16;
+constexpr const int BLOCK_RANGE     = 4000; // beyond, the search can't reach
+
+// Blocker searches the move of our pod `my2` against the leading opponent,
+// turn by turn: our pod picks a move, the opponent answers with the move that
+// is the worst for us as if it knew ours (paranoid), and both are played at
+// once, while the 2 other pods play greedy. Alpha-beta prunes the moves that
+// can't change the result, and moves are tried first when they caused cutoffs
+// before, including in the previous iterations. Iterative deepening goes on
+// until the budget expires; the move of the last complete iteration is played.
+struct Blocker {
+  // Returns the depth of the last complete iteration.
+  int operator() (const State& root, const Map& m, bool first, TurnBudget& budget) {
+    _map = &m; _first = first; _budget = &budget;
+    _target = leader(root, m);
+    _best = move(root.pods[my2], greedy(root, m, my2));
+    _aborted = false;
+    for (auto& h : _history) { h.fill(0); }
+    int depth = 0;
+    for (int d = 1; d <= BLOCK_MAX_DEPTH; ++d) {
+      int mv = -1;
+      _max(root, d, 0, -INF, INF, &mv);
+      if (_aborted) { break; }
+      _best = discrete(mv);
+      _rootMove = mv;
+      depth = d;
+    }
+    return depth;
+  }
+
+  Move best() const { return _best; }
+
+private:
+  static constexpr const int INF = 1 << 30;
+
+  // The target is slowed down, while our pod waits for it on the way to its
+  // next checkpoint, and our racer goes on.
+  int _evaluate(const State& s) const {
+    return progress(s, *_map, my1) - 2 * progress(s, *_map, _target)
+      - mag(_map->cps[s.cps[_target]] - pos(s.pods[my2])) / 2;
+  }
+
+  bool _expired() {
+    if (_budget->expired()) { _aborted = true; }
+    return _aborted;
+  }
+
+  // Moves of the ply, the most promising first.
+  array<int, DISCRETE_MOVES> _ordered(int ply, int side, int first) const {
+    array<int, DISCRETE_MOVES> o;
+    for (int k = 0; k < DISCRETE_MOVES; ++k) { o[k] = k; }
+    const array<int, DISCRETE_MOVES>& h = _history[2 * imin(ply, BLOCK_MAX_DEPTH - 1) + side];
+    std::stable_sort(o.begin(), o.end(), [&](int a, int b) { return h[a] > h[b]; });
+    if (first >= 0) { auto f = std::find(o.begin(), o.end(), first); std::rotate(o.begin(), f, f + 1); }
+    return o;
+  }
+
+  int _max(const State& s, int depth, int ply, int alpha, int beta, int* best) {
+    if (depth == 0) { return _evaluate(s); }
+    int v = -INF;
+    for (int mv : _ordered(ply, 0, (ply == 0) ? _rootMove : -1)) {
+      int r = _min(s, mv, depth, ply, imax(alpha, v), beta);
+      if (_aborted) { return v; }
+      if (r > v) { v = r; if (best) { *best = mv; } }
+      if (v >= beta) { _history[2 * imin(ply, BLOCK_MAX_DEPTH - 1)][mv] += depth * depth; break; }
+    }
+    return v;
+  }
+
+  int _min(const State& s, int mv, int depth, int ply, int alpha, int beta) {
+    int v = INF;
+    for (int om : _ordered(ply, 1, -1)) {
+      if (om == 9) { continue; }      // the opponent doesn't shield
+      if (_expired()) { return v; }
+      State c = s;
+      array<Command, 4> cmds;
+      for (int i = 0; i < 4; ++i) { cmds[i] = greedy(s, *_map, i); }
+      cmds[my2] = command(s.pods[my2], discrete(mv));
+      cmds[_target] = command(s.pods[_target], discrete(om));
+      simulate(c, *_map, cmds, _first && ply == 0);
+      int r = _max(c, depth - 1, ply + 1, alpha, imin(beta, v), nullptr);
+      if (_aborted) { return v; }
+      if (r < v) { v = r; }
+      if (v <= alpha) { _history[2 * imin(ply, BLOCK_MAX_DEPTH - 1) + 1][om] += depth * depth; break; }
+    }
+    return v;
+  }
+
+  array<array<int, DISCRETE_MOVES>, 2 * BLOCK_MAX_DEPTH> _history;
+  const Map* _map = nullptr;
+  TurnBudget* _budget = nullptr;
+  Move _best = {0, 0, false, false};
+  int _rootMove = -1;
+  int _target = th1;
+  bool _first = false;
+  bool _aborted = false;
+};
+
+constexpr const int PLAN_TOLERANCE = 100; // prediction error that drops a plan
+
+// PlanCache carries the best plan of a turn over to the next one. `store`
+// keeps the plan, whose first moves must be the ones played, and predicts
+// where our pods will be, with greedy opponents. `load` checks the prediction
+// against the state observed next turn: if our pods are where expected, the
+// plan is shifted by a move, and the greedy move at its end fills the tail.
+// Otherwise, something unexpected happened, such as a bump, and the plan is
+// dropped. The predicted state and plan are what Ponder searches from.
+struct PlanCache {
+  void store(const State& root, const Map& m, const Plan& plan, bool first) {
+    _plan = plan;
+    _predicted = root;
+    simulate(_predicted, m, _commands(root, m, 0), first);
+    _next = _shifted(_predicted, m);
+    _valid = true;
+  }
+
+  const State& predicted() const { return _predicted; }
+  const Plan& next() const { return _next; }
+
+  // Returns the plan to seed the search with, or nullptr.
+  const Plan* load(const State& s, const Map& m) {
+    if (!_valid) { return nullptr; }
+    _valid = false;
+    for (int i : {my1, my2}) {
+      const Particle& p = s.pods[i];
+      const Particle& q = _predicted.pods[i];
+      if (s.cps[i] != _predicted.cps[i]
+          || distsq(pos(p), pos(q)) > sq(PLAN_TOLERANCE)
+          || distsq(spd(p), spd(q)) > sq(PLAN_TOLERANCE)) { return nullptr; }
+    }
+    _plan = _shifted(s, m);
+    return &_plan;
+  }
+
+private:
+  // The plan a move later, from state `s`.
+  Plan _shifted(const State& s, const Map& m) const {
+    Plan p;
+    for (int d = 0; d + 1 < PLAN_DEPTH; ++d) {
+      p[d] = _plan[d + 1];
+      p[PLAN_DEPTH + d] = _plan[PLAN_DEPTH + d + 1];
+    }
+    State e = s;
+    for (int d = 1; d < PLAN_DEPTH; ++d) { simulate(e, m, _commands(e, m, d)); }
+    p[PLAN_DEPTH - 1] = encode(e.pods[my1], greedy(e, m, my1));
+    p[2 * PLAN_DEPTH - 1] = encode(e.pods[my2], greedy(e, m, my2));
+    return p;
+  }
+
+  array<Command, 4> _commands(const State& s, const Map& m, int d) const {
+    array<Command, 4> cmds;
+    cmds[my1] = decode(s.pods[my1], _plan[d]);
+    cmds[my2] = decode(s.pods[my2], _plan[PLAN_DEPTH + d]);
+    cmds[th1] = greedy(s, m, th1);
+    cmds[th2] = greedy(s, m, th2);
+    return cmds;
+  }
+
+  Plan _plan;
+  Plan _next;
+  State _predicted;
+  bool _valid = false;
+};
+
+// Ponder goes on searching on a worker thread while we wait for the input of
+// the next turn, from the state predicted by the PlanCache. The main thread
+// only parses input meanwhile, and stops the worker as soon as the input
+// arrives. If the prediction holds, the search resumes from the pondered
+// population; otherwise, it starts over.
+struct Ponder {
+  ~Ponder() { stop(); }
+
+  void start(Search& search, const PlanCache& cache, const Map& m) {
+    _stop = false;
+    _thread = std::thread([this, &search, &cache, &m] {
+      _effort = search.ponder(cache.predicted(), m, cache.next(), _stop);
+    });
+  }
+
+  // Returns the effort of the search since `start`, or 0 if there was none.
+  int stop() {
+    if (!_thread.joinable()) { return 0; }
+    _stop = true;
+    _thread.join();
+    return _effort;
+  }
+
+private:
+  std::atomic<bool> _stop{false};
+  std::thread _thread;
+  int _effort = 0;
+};
+
+constexpr const int PLANNER_SHARE = 60; // percent of the turn, the rest blocks
+
+// The command for our pod `i` playing move `mv`. Once its boost is spent, a
+// BOOST is sent as the plain thrust that the rollouts simulated.
+inline Command order(const State& s, int i, Move mv) {
+  if (!s.boosts[i]) { mv.boost = false; }
+  return command(s.pods[i], mv);
+}
+
+// Plays move `mv` for our pod `i`, and keeps track of its boost and shield.
+inline void play(State& s, int i, const Move& mv) {
+  Command c = order(s, i, mv);
+  play(c);
+  spend(s, i, c);
+}
+
+// Plans the moves of our pods within the `budget` of the turn, starting from
+// last turn's plan when it still holds, and plays them: `my1` races with the
+// plan, and `my2` blocks the leading opponent when it is ahead of `my1` and
+// within reach, or follows the plan otherwise. If the watchdog played the
+// greedy moves in the meantime, they are the ones kept track of. The search
+// resumes from what was `pondered`, if anything, and goes on pondering once
+// we have answered.
+inline void decide(State& s, const Map& m, bool first, TurnBudget& budget,
+                   Search& planner, Blocker& blocker, PlanCache& cache,
+                   [[maybe_unused]] Ponder& ponder, int pondered = 0) {
+  array<Command, 2> fallback = {greedy(s, m, my1), greedy(s, m, my2)};
+  budget.fallback(fallback[0], fallback[1]);
+  int th = leader(s, m);
+  bool block = progress(s, m, th) > progress(s, m, my1)
+    && distsq(pos(s.pods[th]), pos(s.pods[my2])) < sq(BLOCK_RANGE);
+  const Plan* warm = cache.load(s, m);
+  budget.share(block ? PLANNER_SHARE : 100);
+  int effort = (warm && pondered > 0) ? planner.resume(s, m, first, budget)
+                                      : planner(s, m, first, budget, warm);
+  budget.share(100);
+  int depth = block ? blocker(s, m, first, budget) : 0;
+  Plan plan = planner.plan();
+  if (block) { plan[PLAN_DEPTH] = pack(blocker.best()); }
+  bool late = !budget.answer();
+  if (late) {
+    spend(s, my1, fallback[0]);
+    spend(s, my2, fallback[1]);
+  } else {
+    cache.store(s, m, plan, first);
+    play(s, my1, unpack(plan[0]));
+    play(s, my2, unpack(plan[PLAN_DEPTH]));
+  }
+  cerr << Search::EFFORT << "\t" << effort << "\tBlocker depth\t" << depth
+       << "\tWarm\t" << (warm != nullptr) << "\tPondered\t" << pondered
+       << "\tTime\t" << budget.elapsed() << (late ? "\tLate" : "") << endl;
+#ifndef NO_PONDER
+  if (!late) { ponder.start(planner, cache, m); }
+#endif
+}
+
+#ifdef BENCHMARK
+// Build with -DBENCHMARK to measure the rollouts per second of `simulate` on
+// a made up map, with pods chasing their checkpoints.
+inline int benchmark() {
+  constexpr const int ROLLOUTS = 20000;
+  constexpr const int DEPTH = 6;
+  Map m;
+  m.numLaps = 3;
+  for (Vec2 cp : {Vec2{4000, 1000}, Vec2{-5000, 2500}, Vec2{-1000, -3000}, Vec2{5500, -2000}}) {
+    m.cps.push_back(cp);
+    m.cpBoxes.push_back({cp - Vec2{CP_RADIUS, CP_RADIUS},
+                         cp + Vec2{CP_RADIUS + 1, CP_RADIUS + 1}});
+  }
+  State s0 = initState();
+  for (int i = 0; i < 4; ++i) {
+    s0.pods[i] = {{x(m.cps[0]) - 1500 + i * 1000, y(m.cps[0])}, {0, 0}, 0, POD_RADIUS, POD_MASS};
+    s0.cps[i] = 1;
+  }
+  auto rollout = [&](int r) {
+    State s = s0;
+    for (int d = 0; d < DEPTH; ++d) {
+      array<Command, 4> cmds;
+      for (int i = 0; i < 4; ++i)
+        { cmds[i] = {m.cps[s.cps[i]], (r + i * 7 + d) % (MAX_THRUST + 1), d == r % 50, false}; }
+      simulate(s, m, cmds, r == 0 && d == 0);
+    }
+    return s.cps[my1] + x(pos(s.pods[th2]));
+  };
+  int sum = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int r = 0; r < ROLLOUTS; ++r) { sum += rollout(r); }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = end - start;
+  cout << "simulate() rollouts of " << DEPTH << " turns per second:\t"
+       << ROLLOUTS / elapsed.count() << " (" << sum << ")" << endl;
+  // Then on every core, with the best rollout found whatever the scheduling.
+  ThreadPool<> pool(imax(1, int(std::thread::hardware_concurrency())) - 1);
+  int best = 0;
+  start = std::chrono::high_resolution_clock::now();
+  int r = pool.best(ROLLOUTS, rollout, 64, &best);
+  end = std::chrono::high_resolution_clock::now();
+  elapsed = end - start;
+  cout << "simulate() rollouts of " << DEPTH << " turns per second on " << pool.size() + 1
+       << " thread(s):\t" << ROLLOUTS / elapsed.count() << " (" << r << ": " << best << ")" << endl;
+  return 0;
+}
+#endif
+
 /**
  * Rotation & acceleration test
  **/
 int main()
 {
+#ifdef BENCHMARK
+  return benchmark();
+#endif
   Physics<InstantThrustModel, BasicDragModel<MAX_THRUST, MAX_SPEED>> phys;
+  static TurnBudget budget;
+  budget.start(true); // the map is read within the first turn
   Map map = readMap();
   bool boost_used = false;
   History hist(initState());
   auto curr = anchor<0>(hist);
   auto prev = anchor<1>(hist);
+  static Search planner;  // large, kept off the stack
+  static Blocker blocker;
+  static PlanCache cache;
+  static Ponder ponder;
   readState(*curr);
-  Ray2 push = AdvTargetAction<MAX_THRUST, MAX_POD_ROTATION>(map.cps[curr->cps[my1]], CP_RADIUS - 50)(curr->pods[my1]);
-  thrust(pos(curr->pods[my1]) + vec({angle(push), 2000}), rad(push));
-  push = AdvTargetAction<MAX_THRUST, MAX_POD_ROTATION>(map.cps[curr->cps[my2]], CP_RADIUS - 50)(curr->pods[my2]);
-  thrust(pos(curr->pods[my2]) + vec({angle(push), 2000}), rad(push));
+  decide(*curr, map, true, budget, planner, blocker, cache, ponder);
   // if (linear_collide(pos(curr->myPod), pos(curr->thPod),
   //                    pos(reaction(curr->myPod, vec(push), phys)),
   //                    pos(curr->thPod) + spd(curr->thPod),
@@ -793,7 +2956,7 @@ int main()
   //     && iabs(angle(curr->myCpRay)) < MAX_POD_ROTATION
   //     && rad(curr->myCpRay) > 2000
   //     && rad(push) == MAX_THRUST) {
-  //   boost(pos(curr->myPod) + vec({angle(push), 2000}));
+  //   boostTo(pos(curr->myPod) + vec({angle(push), 2000}));
   //   boost_used = true;
   // }
   // else
@@ -802,11 +2965,11 @@ int main()
   // game loop
   while (1) {
     hist.rotate();
+    budget.start(false);
+    int pondered = ponder.stop();
     readState(*curr);
-    push = AdvTargetAction<MAX_THRUST, MAX_POD_ROTATION>(map.cps[curr->cps[my1]], CP_RADIUS - 50)(curr->pods[my1]);
-    thrust(pos(curr->pods[my1]) + vec({angle(push), 2000}), rad(push));
-    push = AdvTargetAction<MAX_THRUST, MAX_POD_ROTATION>(map.cps[curr->cps[my2]], CP_RADIUS - 50)(curr->pods[my2]);
-    thrust(pos(curr->pods[my2]) + vec({angle(push), 2000}), rad(push));
+    countLaps(*curr, *prev);
+    decide(*curr, map, false, budget, planner, blocker, cache, ponder, pondered);
     // if (linear_collide(pos(curr->myPod), pos(curr->thPod),
     //                    pos(reaction(curr->myPod, vec(push), phys)),
     //                    pos(curr->thPod) + spd(curr->thPod),
@@ -820,7 +2983,7 @@ int main()
     //     && iabs(angle(curr->myCpRay)) < MAX_POD_ROTATION
     //     && rad(curr->myCpRay) > 2000
     //     && rad(push) == MAX_THRUST) {
-    //   boost(pos(curr->myPod) + vec({angle(push), 2000}));
+    //   boostTo(pos(curr->myPod) + vec({angle(push), 2000}));
     //   boost_used = true;
     // }
     // else
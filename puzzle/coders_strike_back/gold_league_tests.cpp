@@ -0,0 +1,109 @@
+#define BOOST_TEST_MODULE Gold League Tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <sstream>
+
+// The bot is a single file for the contest: its own main is renamed out of
+// the way, to test the rules it plays by.
+#define main gold_league_main
+#include "gold_league.cpp"
+#undef main
+
+inline Map testMap() {
+  Map m;
+  m.numLaps = 3;
+  for (Vec2 cp : {Vec2{4000, 1000}, Vec2{-5000, 2500}, Vec2{-1000, -3000}}) {
+    m.cps.push_back(cp);
+    m.cpBoxes.push_back({cp - Vec2{CP_RADIUS, CP_RADIUS},
+                         cp + Vec2{CP_RADIUS + 1, CP_RADIUS + 1}});
+  }
+  return m;
+}
+
+BOOST_AUTO_TEST_CASE(test_spend) {
+  State s = initState();
+  Command shield = {{0, 0}, MAX_THRUST, false, true};
+  Command boost = {{0, 0}, MAX_THRUST, true, false};
+  BOOST_CHECK_EQUAL(spend(s, 0, shield), MAX_THRUST);
+  // The referee ignores BOOST during the shield cooldown: the boost is kept
+  for (int t = 0; t < SHIELD_TURNS; ++t) { BOOST_CHECK_EQUAL(spend(s, 0, boost), 0); }
+  BOOST_CHECK(s.boosts[0]);
+  BOOST_CHECK_EQUAL(spend(s, 0, boost), BOOST_THRUST);
+  BOOST_CHECK(!s.boosts[0]);
+  // Once spent, BOOST is a plain thrust
+  BOOST_CHECK_EQUAL(spend(s, 0, boost), MAX_THRUST);
+}
+
+BOOST_AUTO_TEST_CASE(test_simulate_boost_during_shield) {
+  Map m = testMap();
+  State s = initState();
+  for (int i = 0; i < 4; ++i) {
+    s.pods[i] = {{-6000 + i * 4000, -4000}, {0, 0}, 0, POD_RADIUS, POD_MASS};
+    s.cps[i] = 1;
+  }
+  CsbPhysics csb;
+  Vec2 target = {8000, -4000};
+  array<Command, 4> cmds;
+  cmds.fill({target, 0, false, false});
+  cmds[0] = {target, MAX_THRUST, false, true};
+  simulate(s, m, cmds);
+  cmds[0] = {target, MAX_THRUST, true, false};
+  for (int t = 0; t < SHIELD_TURNS; ++t) {
+    Particle coasting = csb(s.pods[0], {target, 0, false});
+    simulate(s, m, cmds);
+    BOOST_CHECK_EQUAL(s.pods[0], coasting);
+    BOOST_CHECK(s.boosts[0]);
+  }
+  Particle boosted = csb(s.pods[0], {target, BOOST_THRUST, false});
+  simulate(s, m, cmds);
+  BOOST_CHECK_EQUAL(s.pods[0], boosted);
+  BOOST_CHECK(!s.boosts[0]);
+}
+
+// What play() prints for our pod `i` playing `mv`.
+inline std::string played(State& s, int i, const Move& mv) {
+  std::ostringstream out;
+  std::streambuf* std_out = cout.rdbuf(out.rdbuf());
+  play(s, i, mv);
+  cout.rdbuf(std_out);
+  return out.str();
+}
+
+BOOST_AUTO_TEST_CASE(test_play_spent_boost) {
+  State s = initState();
+  s.pods[0] = {{0, 0}, {0, 0}, 0, POD_RADIUS, POD_MASS};
+  Move mv = {0, 40, true, false};
+  BOOST_CHECK(order(s, 0, mv).boost);
+  BOOST_CHECK_NE(played(s, 0, mv).find("BOOST"), std::string::npos);
+  BOOST_CHECK(!s.boosts[0]);
+  // The boost is spent: the move is played, and simulated, as a thrust of 40
+  Command c = order(s, 0, mv);
+  BOOST_CHECK(!c.boost);
+  BOOST_CHECK_EQUAL(c.thrust, 40);
+  BOOST_CHECK_EQUAL(played(s, 0, mv), "18000 4500 40\n");
+  State t = initState();
+  t.boosts[0] = false;
+  BOOST_CHECK_EQUAL(spend(t, 0, c), 40);
+}
+
+BOOST_AUTO_TEST_CASE(test_crossover_mutate) {
+  Plan a, b, masks, noise;
+  for (int g = 0; g < GENES; ++g) {
+    a[g] = pack({-MAX_POD_ROTATION, 0, false, false});
+    b[g] = pack({MAX_POD_ROTATION, MAX_THRUST, true, false});
+    masks[g] = (g % 2) ? PackedMove(-1) : ROTATION_BITS;
+    noise[g] = pack({3, 7, false, true});
+  }
+  Plan child = crossover(a, b, masks);
+  Plan mutant = mutate(b, noise, masks);
+  for (int g = 0; g < GENES; ++g) {
+    Move c = unpack(child[g]), m = unpack(mutant[g]);
+    // Odd genes come whole from the first plan, even genes only their rotation
+    BOOST_CHECK_EQUAL(c.rotation, -MAX_POD_ROTATION);
+    BOOST_CHECK_EQUAL(c.thrust, (g % 2) ? 0 : MAX_THRUST);
+    BOOST_CHECK_EQUAL(c.boost, g % 2 == 0);
+    BOOST_CHECK_EQUAL(m.rotation, 3);
+    BOOST_CHECK_EQUAL(m.thrust, (g % 2) ? 7 : MAX_THRUST);
+    BOOST_CHECK_EQUAL(m.shield, g % 2 == 1);
+  }
+}
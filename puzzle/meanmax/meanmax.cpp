@@ -156,10 +156,83 @@ struct Unit {
 
 typedef vector<Unit> Units;
 
+// A uniform grid over the game disc, so that proximity tests only look at the
+// units in a few cells instead of all of them. It is rebuilt in O(n) with a
+// counting sort every frame, and doesn't allocate once the index has grown.
+// Units outside the disc are clamped in the border cells.
+struct Grid {
+    static const int CELL = 1000;
+    static const int SIDE = (2 * GAME_RAD) / CELL;
+    static const int CELLS = SIDE * SIDE;
+
+    Grid() : units(nullptr), maxRadius(0), start(), mask(), index() { }
+
+    static int cell(int v) {
+        int c = (v + GAME_RAD) / CELL;
+        return c < 0 ? 0 : (c >= SIDE ? SIDE - 1 : c);
+    }
+
+    static int cell(const Vec2<int>& p) { return cell(p.y()) * SIDE + cell(p.x()); }
+
+    void build(const Units& us) {
+        units = &us;
+        maxRadius = 0;
+        start.fill(0);
+        mask.fill(0);
+        for (const Unit& u : us) {
+            if (u.type == UnitType::Ignore) continue;
+            int c = cell(u.pos);
+            ++start[c + 1];
+            mask[c] |= 1 << u.type;
+            if (u.radius > maxRadius) maxRadius = u.radius;
+        }
+        for (int c = 0; c < CELLS; ++c) start[c + 1] += start[c];
+        index.resize(start[CELLS]);
+        array<int, CELLS + 1> cursor = start;
+        for (size_t i = 0; i < us.size(); ++i) {
+            if (us[i].type == UnitType::Ignore) continue;
+            index[cursor[cell(us[i].pos)]++] = i;
+        }
+    }
+
+    // Returns the first unit of type `ut` in the cells overlapped by the disc
+    // of radius `range` (grown by the largest unit radius) for which `pred`
+    // holds, or nullptr.
+    template<typename Pred>
+    const Unit* find(const Vec2<int>& at, int range, UnitType ut, Pred pred) const {
+        int r = range + maxRadius;
+        int x0 = cell(at.x() - r), x1 = cell(at.x() + r);
+        int y0 = cell(at.y() - r), y1 = cell(at.y() + r);
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                int c = cy * SIDE + cx;
+                if ((mask[c] & (1 << ut)) == 0) continue;
+                for (int i = start[c]; i < start[c + 1]; ++i) {
+                    const Unit& u = (*units)[index[i]];
+                    if (u.type == ut && pred(u)) return &u;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Visit all units of type `ut` in the cells overlapped by the disc.
+    template<typename Fn>
+    void each(const Vec2<int>& at, int range, UnitType ut, Fn fn) const {
+        find(at, range, ut, [&fn](const Unit& u) { fn(u); return false; });
+    }
+
+    const Units* units;
+    int maxRadius;
+    array<int, CELLS + 1> start; // first index of each cell, and the end
+    array<int, CELLS> mask;      // bit mask of the unit types in each cell
+    vector<int> index;           // units indices, sorted by cell
+};
+
 struct Frame {
     Frame() : myScore(0), theirScore(0), myRage(0), theirRage(0),
         myReap(nullptr), theirReap(nullptr), myDestroy(nullptr), theirDestroy(nullptr),
-        units() { }
+        units(), grid() { }
 
     int myScore;
     int theirScore;
@@ -170,6 +243,7 @@ struct Frame {
     Unit* myDestroy;
     Unit* theirDestroy;
     Units units;
+    Grid grid;
 };
 
 inline istream& operator >> (istream& in, Frame& fr) {
@@ -215,6 +289,7 @@ inline istream& operator >> (istream& in, Frame& fr) {
     for (size_t i = unitCount; i < fr.units.size(); ++i) {
         fr.units[i].type = UnitType::Ignore;
     }
+    fr.grid.build(fr.units);
     return in;
 }
 
@@ -226,13 +301,11 @@ inline void derive(Frame& curr, const Frame& prev)
     curr.theirReap->accel = curr.theirReap->speed - prev.theirReap->speed;
 }
 
-inline const Unit* find_collision(const Unit& a, const Units& us, UnitType ut, int rad)
+inline const Unit* find_collision(const Unit& a, const Grid& g, UnitType ut, int rad)
 {
-    for (const Unit& u : us) {
-        if (u.type == ut && collide(a.pos, u.pos, u.radius, a.radius))
-            return &u;
-    }
-    return nullptr;
+    return g.find(a.pos, rad, ut, [&a](const Unit& u) {
+        return collide(a.pos, u.pos, u.radius, a.radius);
+    });
 }
 
 // Commands
@@ -308,12 +381,11 @@ struct ReaperTactics {
             case ReapState::Annoy: {
                 if (curr.myRage > SKILL_COST * 2) { // so we can combo!
                     // if ennemy is close to a wreck...
-                    for (const Unit& u : curr.units) {
-                        if (u.type == UnitType::Wreck
-                            && dist(curr.theirDestroy->pos, u.pos) < sq(SKILL_RAD + u.radius)) {
-                            state = ReapState::EvictDestroy;
-                            break;
-                        }
+                    const Vec2<int>& at = curr.theirDestroy->pos;
+                    if (curr.grid.find(at, SKILL_RAD, UnitType::Wreck, [&at](const Unit& u) {
+                            return dist(at, u.pos) < sq(SKILL_RAD + u.radius);
+                        }) != nullptr) {
+                        state = ReapState::EvictDestroy;
                     }
                     // if their reap has been bothering our destroy
                     if (state == ReapState::Annoy && prev.myDestroy != nullptr
@@ -399,33 +471,27 @@ struct DestroyerTactics {
     {
         priorities.resize(0); // remove elements but don't deallocate
         priorities.reserve(curr.units.size());
-        // Establish the list of priorities:
-        for (const Unit& u : curr.units) {
-            switch (u.type) {
-                case UnitType::Tanker: {
-                    // if the tanker is approaching, good.
-                    int mag_speed = mag(u.speed);
-                    if (mag(u.speed + normalize(u.pos, mag_speed)) < mag_speed) {
-                        // if it's within bounds, add it, otherwise don't care.
-                        if (magsq(u.pos) < sq(GAME_RAD))
-                            priorities.push_back({&u, heuristic(u, *curr.myDestroy)});
-                    }
-                    else {
-                        // If still within game radius but closer to exit that we are to it
-                        if (sq(u.radius) + magsq(u.pos) < sq(GAME_RAD)
-                            && sq(GAME_RAD) - magsq(u.pos) > dist(u.pos, curr.myDestroy->pos))
-                            priorities.push_back({&u, heuristic(u, *curr.myDestroy)});
-                    }
-                }
-                break;
-                case UnitType::Wreck: {
-                    // if it is covered by an oil pool, ignore it.
+        // Establish the list of priorities, only tankers and wrecks matter:
+        const Vec2<int> center{0, 0};
+        curr.grid.each(center, GAME_RAD, UnitType::Tanker, [&](const Unit& u) {
+            // if the tanker is approaching, good.
+            int mag_speed = mag(u.speed);
+            if (mag(u.speed + normalize(u.pos, mag_speed)) < mag_speed) {
+                // if it's within bounds, add it, otherwise don't care.
+                if (magsq(u.pos) < sq(GAME_RAD))
                     priorities.push_back({&u, heuristic(u, *curr.myDestroy)});
-                }
-                default:
-                break;
             }
-        }
+            else {
+                // If still within game radius but closer to exit that we are to it
+                if (sq(u.radius) + magsq(u.pos) < sq(GAME_RAD)
+                    && sq(GAME_RAD) - magsq(u.pos) > dist(u.pos, curr.myDestroy->pos))
+                    priorities.push_back({&u, heuristic(u, *curr.myDestroy)});
+            }
+        });
+        curr.grid.each(center, GAME_RAD, UnitType::Wreck, [&](const Unit& u) {
+            // if it is covered by an oil pool, ignore it.
+            priorities.push_back({&u, heuristic(u, *curr.myDestroy)});
+        });
         sort(priorities.begin(), priorities.end(), [](const Priority& a, const Priority& b){ return (a < b); });
     }
 
@@ -435,7 +501,7 @@ struct DestroyerTactics {
         updatePriorities(curr, prev);
 
         // if I'm in an wreck, collect it!
-        const Unit* wreck = find_collision(*curr.myDestroy, curr.units, UnitType::Wreck, curr.myDestroy->radius);
+        const Unit* wreck = find_collision(*curr.myDestroy, curr.grid, UnitType::Wreck, curr.myDestroy->radius);
         if (wreck != nullptr) {
             cout << wreck->x() << " " << wreck->y() << " 300 " << " take: " << wreck->id << endl;
         }